@@ -0,0 +1,96 @@
+// Equivalence check for batchDenoiser: feeds a number of streams unevenly
+// (each round every stream gets 0 to 3 samples, so their rings drift out of
+// lockstep and tiles mix due and idle lanes) to one batchDenoiser and to one
+// denoiser<> per stream, and compares every emitted hop sample. Exits
+// non-zero on the first stream that emits when the other does not, or on
+// an output that differs: bit for bit in the default build, by more than a
+// few ulp with IMU_DENOISE_NATIVE (see batchDenoiser.hpp).
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "IMUreceiver.hpp"
+#include "batchDenoiser.hpp"
+#include "waveletDenoiser.hpp"
+
+namespace {
+
+#ifdef IMU_DENOISE_NATIVE
+constexpr double tolerance = 1e-14;
+#else
+constexpr double tolerance = 0.0;
+#endif
+
+bool same(double a, double b) {
+    return a == b || std::fabs(a - b) <= tolerance * std::fmax(1.0, std::fabs(b));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int streams = (argc > 1) ? std::atoi(argv[1]) : 21;
+    const long rounds = (argc > 2) ? std::atol(argv[2]) : 20000;
+    if (streams < 1 || rounds < 1) {
+        std::fprintf(stderr, "usage: batch_check [streams] [rounds]\n");
+        return 1;
+    }
+
+    batchDenoiser batch(streams);
+    std::vector<denoiser<>> ref(streams);
+    for (auto& d : ref) IMU::setup_denoiser(d);
+
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 0.02);
+    std::vector<long> n(streams, 0);  // samples pushed per stream
+    long hops = 0, ulps = 0;
+    double worst = 0;
+
+    for (long r = 0; r < rounds; ++r) {
+        // at most 3 per round, so no stream gets a second hop before denoise()
+        for (int s = 0; s < streams; ++s) {
+            for (int k = static_cast<int>(rng() % 4); k > 0; --k, ++n[s]) {
+                const double t = 0.01 * static_cast<double>(n[s]);
+                const double sway = 0.1 * std::sin(0.03 * static_cast<double>(n[s]) + s);
+                const double ax = sway + noise(rng), ay = noise(rng), az = 1.0 + noise(rng);
+                batch.push(s, t, ax, ay, az);
+                ref[s].push(t, ax, ay, az);
+            }
+        }
+        batch.denoise();
+        for (int s = 0; s < streams; ++s) {
+            const bool emitted = ref[s].denoise();
+            if (emitted != batch.emitted(s)) {
+                std::fprintf(stderr, "round %ld, stream %d: denoiser<> %s, batchDenoiser %s\n", r, s,
+                             emitted ? "emitted" : "did not emit", batch.emitted(s) ? "did" : "did not");
+                return 1;
+            }
+            if (!emitted) continue;
+            ++hops;
+            const double* got[3] = {batch.out_x(s), batch.out_y(s), batch.out_z(s)};
+            const double* want[3] = {ref[s].out_x().data(), ref[s].out_y().data(), ref[s].out_z().data()};
+            for (int axis = 0; axis < 3; ++axis) {
+                for (int k = 0; k < batchDenoiser::hop; ++k) {
+                    const double a = got[axis][k], b = want[axis][k];
+                    if (a != b) {
+                        ++ulps;
+                        worst = std::fmax(worst, std::fabs(a - b));
+                    }
+                    if (!same(a, b)) {
+                        std::fprintf(stderr, "round %ld, stream %d, axis %d, sample %d: %.17g, expected %.17g\n",
+                                     r, s, axis, k, a, b);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    std::printf("batchDenoiser: %d streams, %ld hops equal to denoiser<>", streams, hops);
+    if (ulps > 0) std::printf(" (%ld outputs off by up to %.3g)", ulps, worst);
+    std::printf("\n");
+    return 0;
+}
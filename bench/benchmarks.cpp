@@ -0,0 +1,445 @@
+// Google Benchmark suite for the live ingest path, to track regressions
+// between releases:
+//
+//   denoiser/throughput     push + denoise, samples/s
+//   denoiser/hop            one hop (hop pushes + denoise()), with the
+//                           per-hop latency distribution as counters
+//   denoiser/streams/N      one hop for each of N denoiser<> instances
+//   denoiser/batch/N        the same N streams in one batchDenoiser
+//   parse/imu, parse/gps    lines/s through the receivers' parsers
+//   framing/lines           lineFramer, bytes/s
+//   framing/messages        wire::next over NDJSON, as the servers read
+//   fusion/devices/N        one IMU tick (and a fix every 100) to N
+//                           fusionFilters, filter steps/s
+//   join/imu_gps            IMU samples/s through a streamJoin with a fix
+//                           every 100
+//
+// Every benchmark runs on synthetic phone data; with --input=session.ndjson
+// the ones that apply also run on that recording (IMU or GPS lines).
+//
+//   benchmarks --benchmark_out=results.json --benchmark_out_format=json
+//
+// writes the results as JSON (the benchmarks_json target does just that).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "GPSreceiver.hpp"
+#include "IMUreceiver.hpp"
+#include "batchDenoiser.hpp"
+#include "fusionEngine.hpp"
+#include "streamJoin.hpp"
+#include "lineFramer.hpp"
+#include "waveletDenoiser.hpp"
+#include "wireFormat.hpp"
+
+namespace {
+
+struct acc {
+    double t, x, y, z;
+};
+
+// One input set: lines as a client would send them, and the IMU samples
+// among them
+struct dataset {
+    std::vector<std::string> imu_lines;
+    std::vector<std::string> gps_lines;
+    std::string stream;  // all lines, '\n'-terminated
+    std::vector<acc> samples;
+};
+
+dataset synthetic()
+{
+    dataset d;
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 0.02);
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    char buf[320];
+
+    // 100 Hz phone: gravity on z, a slow sway, sensor noise
+    for (int i = 0; i < 65536; ++i) {
+        const double t = 1.7e9 + 0.01 * i;
+        const double sway = 0.1 * std::sin(2 * M_PI * 0.5 * 0.01 * i);
+        std::snprintf(buf, sizeof(buf),
+                      "{\"t\":%.6f,\"quat\":[%.17g,%.17g,%.17g,%.17g],\"acc_g\":[%.9g,%.9g,%.9g]}", t,
+                      u(rng), u(rng), u(rng), u(rng), sway + noise(rng), noise(rng), 1.0 + noise(rng));
+        d.imu_lines.emplace_back(buf);
+    }
+    for (int i = 0; i < 4096; ++i) {
+        std::snprintf(buf, sizeof(buf),
+                      "{\"t\":%.6f,\"lat\":%.8f,\"lon\":%.8f,\"alt\":%.2f,\"hAcc\":%.1f,\"vAcc\":%.1f,"
+                      "\"speed\":%.2f,\"course\":%.1f,\"t_gps\":%.3f}",
+                      1.7e9 + i, 48.1 + 1e-5 * i, 11.5 + 1e-5 * i, 520 + u(rng), 3 + u(rng),
+                      4 + u(rng), 1.5 + u(rng), 180 + 90 * u(rng), 1.7e9 + i + 0.2);
+        d.gps_lines.emplace_back(buf);
+    }
+    return d;
+}
+
+// IMU and GPS lines of a recorded NDJSON session; others are skipped
+bool recorded(const std::string& path, dataset& d)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::perror(path.c_str());
+        return false;
+    }
+    std::string line;
+    IMUsample s;
+    GPSsample g;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (IMU::parse_one_quat_accg(line, s)) d.imu_lines.push_back(line);
+        else if (GPS::parse_GPS(line, g)) d.gps_lines.push_back(line);
+    }
+    if (d.imu_lines.empty() && d.gps_lines.empty()) {
+        std::fprintf(stderr, "%s: no IMU or GPS lines\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void finish(dataset& d)
+{
+    for (const auto& l : d.imu_lines) d.stream += l + '\n';
+    for (const auto& l : d.gps_lines) d.stream += l + '\n';
+    IMUsample s;
+    for (const auto& l : d.imu_lines) {
+        IMU::parse_one_quat_accg(l, s);
+        const double* a = s.getAccG();
+        d.samples.push_back({s.getTimestamp(), a[0], a[1], a[2]});
+    }
+}
+
+// -------- denoiser --------
+
+void denoiser_throughput(benchmark::State& state, const dataset* d)
+{
+    const auto& in = d->samples;
+    denoiser<> dn;
+    IMU::setup_denoiser(dn);
+    for (auto _ : state) {
+        for (const acc& s : in) {
+            dn.push(s.t, s.x, s.y, s.z);
+            while (dn.denoise()) benchmark::DoNotOptimize(dn.out_x().data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long>(in.size()));
+}
+
+void denoiser_hop(benchmark::State& state, const dataset* d)
+{
+    using clock = std::chrono::steady_clock;
+    const auto& in = d->samples;
+    denoiser<> dn;
+    IMU::setup_denoiser(dn);
+    std::size_t i = 0;
+    auto next = [&]() -> const acc& {
+        const acc& s = in[i];
+        i = i + 1 == in.size() ? 0 : i + 1;
+        return s;
+    };
+    // a full window first, so every timed hop emits
+    for (int k = 0; k < denoiser<>::windowSize; ++k) {
+        const acc& s = next();
+        dn.push(s.t, s.x, s.y, s.z);
+        dn.denoise();
+    }
+
+    std::vector<double> ns;
+    ns.reserve(1 << 20);
+    for (auto _ : state) {
+        const auto t0 = clock::now();
+        for (int k = 0; k < denoiser<>::hop; ++k) {
+            const acc& s = next();
+            dn.push(s.t, s.x, s.y, s.z);
+        }
+        benchmark::DoNotOptimize(dn.denoise());
+        const auto t1 = clock::now();
+        if (ns.size() < ns.capacity()) ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    state.SetItemsProcessed(state.iterations() * denoiser<>::hop);
+
+    if (ns.empty()) return;
+    std::sort(ns.begin(), ns.end());
+    auto pct = [&ns](double p) { return ns[static_cast<std::size_t>(p * (ns.size() - 1))]; };
+    state.counters["p50_ns"] = pct(0.50);
+    state.counters["p90_ns"] = pct(0.90);
+    state.counters["p99_ns"] = pct(0.99);
+    state.counters["p999_ns"] = pct(0.999);
+    state.counters["max_ns"] = ns.back();
+}
+
+// One hop for each of range(0) streams, as a server holding that many phones
+// at 100 Hz would run them: every stream a different slice of the input, all
+// fed in lockstep. denoiser/streams uses one denoiser<> per stream,
+// denoiser/batch one batchDenoiser for all of them.
+void denoiser_streams(benchmark::State& state, const dataset* d)
+{
+    const int streams = static_cast<int>(state.range(0));
+    const auto& in = d->samples;
+    std::vector<denoiser<>> dn(streams);
+    for (auto& s : dn) IMU::setup_denoiser(s);
+    std::size_t k = 0;
+    auto feed = [&] {
+        for (int j = 0; j < streams; ++j) {
+            const acc& s = in[(k + 97 * static_cast<std::size_t>(j)) % in.size()];
+            dn[j].push(s.t, s.x, s.y, s.z);
+        }
+        ++k;
+    };
+    for (int i = 0; i < denoiser<>::windowSize - denoiser<>::hop; ++i) feed();
+
+    for (auto _ : state) {
+        for (int i = 0; i < denoiser<>::hop; ++i) feed();
+        for (auto& s : dn) benchmark::DoNotOptimize(s.denoise());
+    }
+    state.SetItemsProcessed(state.iterations() * streams * denoiser<>::hop);
+}
+
+void denoiser_batch(benchmark::State& state, const dataset* d)
+{
+    const int streams = static_cast<int>(state.range(0));
+    const auto& in = d->samples;
+    batchDenoiser dn(streams);
+    std::size_t k = 0;
+    auto feed = [&] {
+        for (int j = 0; j < streams; ++j) {
+            const acc& s = in[(k + 97 * static_cast<std::size_t>(j)) % in.size()];
+            dn.push(j, s.t, s.x, s.y, s.z);
+        }
+        ++k;
+    };
+    for (int i = 0; i < batchDenoiser::windowSize - batchDenoiser::hop; ++i) feed();
+
+    for (auto _ : state) {
+        for (int i = 0; i < batchDenoiser::hop; ++i) feed();
+        benchmark::DoNotOptimize(dn.denoise());
+    }
+    state.SetItemsProcessed(state.iterations() * streams * batchDenoiser::hop);
+}
+
+// -------- parsers --------
+
+template <typename Sample, typename Parse>
+void parse(benchmark::State& state, const std::vector<std::string>* lines, Parse fn)
+{
+    Sample s;
+    std::size_t bytes = 0;
+    for (const auto& l : *lines) bytes += l.size();
+    for (auto _ : state) {
+        for (const auto& l : *lines) benchmark::DoNotOptimize(fn(l, s));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long>(lines->size()));
+    state.SetBytesProcessed(state.iterations() * static_cast<long>(bytes));
+}
+
+void parse_imu(benchmark::State& state, const std::vector<std::string>* lines)
+{
+    parse<IMUsample>(state, lines, IMU::parse_one_quat_accg);
+}
+
+void parse_gps(benchmark::State& state, const std::vector<std::string>* lines)
+{
+    parse<GPSsample>(state, lines, GPS::parse_GPS);
+}
+
+// -------- framing --------
+
+// Feeds the stream in 64 KiB reads, as a socket would deliver it
+template <typename Drain>
+void framing(benchmark::State& state, const std::string* stream, Drain drain)
+{
+    constexpr std::size_t read_size = 64 * 1024;
+    lineFramer f(read_size);
+    long messages = 0;
+    for (auto _ : state) {
+        for (std::size_t at = 0; at < stream->size();) {
+            at += f.append(stream->data() + at, std::min(read_size, stream->size() - at));
+            messages += drain(f);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<long>(stream->size()));
+    state.counters["messages"] = benchmark::Counter(static_cast<double>(messages), benchmark::Counter::kIsRate);
+}
+
+void framing_lines(benchmark::State& state, const std::string* stream)
+{
+    framing(state, stream, [](lineFramer& f) {
+        long n = 0;
+        std::string_view line;
+        while (f.next(line)) {
+            benchmark::DoNotOptimize(line.data());
+            ++n;
+        }
+        return n;
+    });
+}
+
+void framing_messages(benchmark::State& state, const std::string* stream)
+{
+    framing(state, stream, [](lineFramer& f) {
+        long n = 0;
+        wire::message m;
+        while (wire::next(f, m)) {
+            benchmark::DoNotOptimize(m.line.data());
+            ++n;
+        }
+        return n;
+    });
+}
+
+// -------- fusion --------
+
+// One 100 Hz IMU tick to each of range(0) devices, and a fix to each every
+// 100 ticks, as a server holding that many phones would see them
+void fusion_devices(benchmark::State& state, const dataset* d)
+{
+    const auto devices = static_cast<fusionEngine::device_id>(state.range(0));
+    const auto& in = d->samples;
+    std::vector<GPSsample> fixes(d->gps_lines.size());
+    for (std::size_t i = 0; i < fixes.size(); ++i) GPS::parse_GPS(d->gps_lines[i], fixes[i]);
+
+    fusionEngine engine{fusionFilter::options()};
+    const double t0 = 1.7e9;
+    GPSsample g = fixes[0];
+    g.setTime(t0);
+    for (fusionEngine::device_id id = 0; id < devices; ++id) engine.gps(id, g);
+
+    std::size_t k = 0;
+    for (auto _ : state) {
+        ++k;
+        const double t = t0 + 0.01 * static_cast<double>(k);
+        const acc& s = in[k % in.size()];
+        // the synthetic phone lies flat: world frame is device frame
+        for (fusionEngine::device_id id = 0; id < devices; ++id) engine.imu(id, t, s.x, s.y, s.z - 1.0);
+        if (k % 100 == 0) {
+            g = fixes[(k / 100) % fixes.size()];
+            g.setTime(t);
+            for (fusionEngine::device_id id = 0; id < devices; ++id) engine.gps(id, g);
+        }
+    }
+    benchmark::DoNotOptimize(engine.device(0).current());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// -------- join --------
+
+// IMU samples through a streamJoin with a fix every 100, one sample per
+// iteration, every sample drained as soon as it is released
+void join_imu_gps(benchmark::State& state, const dataset* d)
+{
+    std::vector<IMUsample> in(d->imu_lines.size());
+    for (std::size_t i = 0; i < in.size(); ++i) IMU::parse_one_quat_accg(d->imu_lines[i], in[i]);
+    std::vector<GPSsample> fixes(d->gps_lines.size());
+    for (std::size_t i = 0; i < fixes.size(); ++i) GPS::parse_GPS(d->gps_lines[i], fixes[i]);
+
+    streamJoin join{streamJoin::options()};
+    streamJoin::joined out;
+    const double t0 = 1.7e9;
+    std::size_t k = 0;
+    for (auto _ : state) {
+        ++k;
+        const double t = t0 + 0.01 * static_cast<double>(k);
+        IMUsample s = in[k % in.size()];
+        s.setTimestamp(t);
+        join.imu(s);
+        if (k % 100 == 0) {
+            GPSsample g = fixes[(k / 100) % fixes.size()];
+            g.setTime(t + 0.2);
+            g.setTGPS(t + 18.0);
+            join.gps(g);
+        }
+        while (join.next(out)) benchmark::DoNotOptimize(out.lat);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void register_all(const char* source, const dataset& d)
+{
+    const std::string tag = std::string("/") + source;
+    if (!d.samples.empty()) {
+        benchmark::RegisterBenchmark(("denoiser/throughput" + tag).c_str(), denoiser_throughput, &d)
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("denoiser/hop" + tag).c_str(), denoiser_hop, &d);
+    }
+    if (!d.imu_lines.empty()) {
+        benchmark::RegisterBenchmark(("parse/imu" + tag).c_str(), parse_imu, &d.imu_lines)
+            ->Unit(benchmark::kMicrosecond);
+    }
+    if (!d.gps_lines.empty()) {
+        benchmark::RegisterBenchmark(("parse/gps" + tag).c_str(), parse_gps, &d.gps_lines)
+            ->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark(("framing/lines" + tag).c_str(), framing_lines, &d.stream)
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("framing/messages" + tag).c_str(), framing_messages, &d.stream)
+        ->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    std::string input;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--input=", 8) == 0) {
+            input = argv[i] + 8;
+        } else {
+            std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+            benchmark::PrintDefaultHelp();
+            std::fprintf(stderr, "  [--input=<session.ndjson>]\n");
+            return 1;
+        }
+    }
+
+    static dataset synth = synthetic();
+    finish(synth);
+    register_all("synthetic", synth);
+
+    // Lines with an extra key take the nlohmann::json fallback
+    static std::vector<std::string> fallback;
+    for (std::size_t i = 0; i < 4096; ++i) {
+        std::string l = synth.imu_lines[i];
+        l.insert(1, "\"src\":\"phone\",");
+        fallback.push_back(std::move(l));
+    }
+    benchmark::RegisterBenchmark("parse/imu/json_fallback", parse_imu, &fallback)
+        ->Unit(benchmark::kMicrosecond);
+
+    for (auto fn : {denoiser_streams, denoiser_batch}) {
+        benchmark::RegisterBenchmark(fn == denoiser_batch ? "denoiser/batch" : "denoiser/streams", fn, &synth)
+            ->Arg(8)
+            ->Arg(64)
+            ->Arg(512)
+            ->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark("fusion/devices", fusion_devices, &synth)
+        ->Arg(1)
+        ->Arg(1000)
+        ->Arg(10000)
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("join/imu_gps", join_imu_gps, &synth);
+
+    static dataset rec;
+    if (!input.empty()) {
+        if (!recorded(input, rec)) return 1;
+        finish(rec);
+        register_all("recorded", rec);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
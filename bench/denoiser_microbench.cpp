@@ -0,0 +1,266 @@
+// Cycles per hop of the denoiser hot path (push hop samples + denoise()).
+//
+// legacy_denoiser below is a condensed copy of the copy-based Haar
+// implementation the lifting scheme replaced; it is the "before" baseline.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "waveletDenoiser.hpp"
+
+namespace {
+
+// TSC ticks on x86, nanoseconds elsewhere (Apple Silicon has no user rdtsc)
+#if defined(__x86_64__) || defined(__i386__)
+const char* tick_unit = "cycles";
+inline std::uint64_t ticks() { return __rdtsc(); }
+#else
+const char* tick_unit = "ns";
+inline std::uint64_t ticks() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+class legacy_denoiser {
+public:
+    static constexpr int windowSize = 64;
+    static constexpr int levels     = 3;
+    static constexpr int hop        = 8;
+
+    legacy_denoiser() {
+        constexpr double pi = 3.1415926;
+        for (int n = 0; n < windowSize; ++n) {
+            win_[n] = 0.5 - 0.5 * std::cos(2.0 * pi * n / (windowSize - 1));
+        }
+    }
+
+    void push(double t, double ax, double ay, double az) {
+        t_[idx] = t; ax_[idx] = ax; ay_[idx] = ay; az_[idx] = az;
+        idx = (idx + 1) % windowSize;
+        if (!full) {
+            count++;
+            if (count >= windowSize) full = true;
+        }
+        hop_counter++;
+    }
+
+    bool denoise() {
+        if (!full) return false;
+        if (hop_counter < hop) return false;
+        hop_counter = 0;
+
+        std::array<double, windowSize> wx{}, wy{}, wz{};
+        int current = idx;
+        for (int i = 0; i < windowSize; ++i) {
+            wx[i] = ax_[current]; wy[i] = ay_[current]; wz[i] = az_[current];
+            current = (current + 1) % windowSize;
+        }
+        denoise_axis_(wx); denoise_axis_(wy); denoise_axis_(wz);
+        shift_left_hop_(ola_x_acc_, ola_x_wsum_);
+        shift_left_hop_(ola_y_acc_, ola_y_wsum_);
+        shift_left_hop_(ola_z_acc_, ola_z_wsum_);
+        add_block_wola_(ola_x_acc_, ola_x_wsum_, wx);
+        add_block_wola_(ola_y_acc_, ola_y_wsum_, wy);
+        add_block_wola_(ola_z_acc_, ola_z_wsum_, wz);
+        for (int k = 0; k < hop; ++k) {
+            out_x_[k] = (ola_x_wsum_[k] > 1e-12) ? (ola_x_acc_[k] / ola_x_wsum_[k]) : 0.0;
+            out_y_[k] = (ola_y_wsum_[k] > 1e-12) ? (ola_y_acc_[k] / ola_y_wsum_[k]) : 0.0;
+            out_z_[k] = (ola_z_wsum_[k] > 1e-12) ? (ola_z_acc_[k] / ola_z_wsum_[k]) : 0.0;
+        }
+        return true;
+    }
+
+    const std::array<double, hop>& out_x() const { return out_x_; }
+
+private:
+    using window_t = std::array<double, windowSize>;
+
+    window_t t_{}, ax_{}, ay_{}, az_{};
+    int idx = 0, count = 0, hop_counter = 0;
+    bool full = false;
+    window_t win_{};
+    window_t ola_x_acc_{}, ola_x_wsum_{}, ola_y_acc_{}, ola_y_wsum_{}, ola_z_acc_{}, ola_z_wsum_{};
+    std::array<double, hop> out_x_{}, out_y_{}, out_z_{};
+
+    static void shift_left_hop_(window_t& acc, window_t& wsum) {
+        for (int i = 0; i < windowSize - hop; ++i) { acc[i] = acc[i + hop]; wsum[i] = wsum[i + hop]; }
+        for (int i = windowSize - hop; i < windowSize; ++i) { acc[i] = 0.0; wsum[i] = 0.0; }
+    }
+
+    void add_block_wola_(window_t& acc, window_t& wsum, const window_t& block) {
+        for (int n = 0; n < windowSize; ++n) { acc[n] += block[n] * win_[n]; wsum[n] += win_[n]; }
+    }
+
+    void denoise_axis_(window_t& w) {
+        haar_dwt(w, levels);
+        double sigma = mad_sigma_from_detail(w, 32, 32);
+        if (sigma > 0.0) {
+            const double T = sigma * std::sqrt(2.0 * std::log(static_cast<double>(windowSize)));
+            soft_threshold_range(w, 32, 32, 1.0 * T);
+            soft_threshold_range(w, 16, 16, 0.6 * T);
+            soft_threshold_range(w,  8,  8, 0.2 * T);
+        }
+        haar_idwt(w, levels);
+    }
+
+    void haar_dwt(window_t& x, int levels) {
+        window_t temp;
+        int length = windowSize;
+        for (int i = 0; i < levels; i++) {
+            int half = length / 2;
+            for (int j = 0; j < half; j++) {
+                temp[j] = (x[2 * j] + x[2 * j + 1]) / std::sqrt(2.0);
+                temp[half + j] = (x[2 * j] - x[2 * j + 1]) / std::sqrt(2.0);
+            }
+            length /= 2;
+            x = temp;
+        }
+    }
+
+    void haar_idwt(window_t& x, int levels) {
+        window_t temp;
+        int length = windowSize;
+        for (int i = 0; i < levels - 1; i++) length /= 2;
+        for (int i = 0; i < levels; i++) {
+            int half = length / 2;
+            for (int j = 0; j < half; j++) {
+                temp[2 * j] = (x[j] + x[half + j]) / std::sqrt(2.0);
+                temp[2 * j + 1] = (x[j] - x[half + j]) / std::sqrt(2.0);
+            }
+            for (int j = 0; j < length; j++) x[j] = temp[j];
+            length *= 2;
+        }
+    }
+
+    double median(window_t v, std::size_t n) {
+        if (n == 0) return 0.0;
+        auto begin = v.begin();
+        auto mid = begin + static_cast<std::ptrdiff_t>(n / 2);
+        std::nth_element(begin, mid, begin + static_cast<std::ptrdiff_t>(n));
+        double m = *mid;
+        if (n % 2 == 0) {
+            auto mid2 = begin + static_cast<std::ptrdiff_t>(n / 2 - 1);
+            std::nth_element(begin, mid2, begin + static_cast<std::ptrdiff_t>(n));
+            m = 0.5 * (m + *mid2);
+        }
+        return m;
+    }
+
+    double mad_sigma_from_detail(const window_t& coeffs, int start, int len) {
+        window_t tmp{};
+        for (int i = 0; i < len; ++i) tmp[i] = coeffs[start + i];
+        double med = median(tmp, len);
+        for (int i = 0; i < len; ++i) tmp[i] = std::fabs(tmp[i] - med);
+        return median(tmp, len) / 0.6745;
+    }
+
+    void soft_threshold_range(window_t& coeffs, int start, int len, double T) {
+        for (int i = start; i < start + len; ++i) {
+            double x = coeffs[i], ax = std::fabs(x);
+            coeffs[i] = (ax <= T) ? 0.0 : (x > 0 ? 1.0 : -1.0) * (ax - T);
+        }
+    }
+};
+
+struct result {
+    double median;
+    double min;
+};
+
+// Feeds the same noisy signal to dn and times every hop (hop pushes + denoise).
+template <typename Denoiser>
+result ticks_per_hop(Denoiser& dn, const std::vector<double>& signal, int hops)
+{
+    constexpr int hop = Denoiser::hop;
+    std::vector<double> samples;
+    samples.reserve(hops);
+
+    std::size_t n = 0;
+    auto feed = [&]() {
+        for (int k = 0; k < hop; ++k, ++n) {
+            const double v = signal[n % signal.size()];
+            dn.push(static_cast<double>(n) * 0.01, v, 0.5 * v, -v);
+        }
+    };
+
+    // warm up: fill the window and the WOLA state
+    while (!dn.denoise()) feed();
+
+    volatile double sink = 0.0;
+    for (int h = 0; h < hops; ++h) {
+        const std::uint64_t t0 = ticks();
+        feed();
+        dn.denoise();
+        const std::uint64_t t1 = ticks();
+        sink = sink + dn.out_x()[0];
+        samples.push_back(static_cast<double>(t1 - t0));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2], samples.front()};
+}
+
+void report(const char* name, result r) {
+    std::printf("  %-34s median %8.0f  min %8.0f %s/hop\n", name, r.median, r.min, tick_unit);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int hops = (argc > 1) ? std::atoi(argv[1]) : 200000;
+
+    // accel-like signal: slow motion plus sensor noise
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 0.02);
+    std::vector<double> signal(1 << 16);
+    for (std::size_t i = 0; i < signal.size(); ++i) {
+        signal[i] = 0.3 * std::sin(0.02 * static_cast<double>(i)) + noise(rng);
+    }
+
+    std::printf("denoiser microbenchmark: window=%d levels=%d hop=%d, %d hops\n",
+                denoiser<>::windowSize, denoiser<>::levels, denoiser<>::hop, hops);
+
+    legacy_denoiser before;
+    report("copy-based Haar (before)", ticks_per_hop(before, signal, hops));
+
+    denoiser<> after;
+    report("in-place lifting Haar (after)", ticks_per_hop(after, signal, hops));
+
+    denoiser<> net;
+    net.set_sigma_estimator(denoiser<>::sigma_estimator::network);
+    report("lifting Haar, network MAD", ticks_per_hop(net, signal, hops));
+
+    denoiser<64, 3, 8, float> after_f;
+    report("in-place lifting Haar, float", ticks_per_hop(after_f, signal, hops));
+
+    // cost per filter length, one line per family and boundary mode
+    std::printf("\nwavelet families (%d hops each):\n", hops / 10);
+    for (int f = 0; f <= static_cast<int>(wavelets::family::coif3); ++f) {
+        const auto fam = static_cast<wavelets::family>(f);
+        for (auto b : {wavelets::boundary::periodic, wavelets::boundary::symmetric}) {
+            denoiser<> dn;
+            dn.set_sigma_estimator(denoiser<>::sigma_estimator::network);
+            dn.set_wavelet(fam, b);
+            char label[64];
+            std::snprintf(label, sizeof(label), "%-5s L=%2d %s", wavelets::name(fam),
+                          wavelets::length(fam),
+                          b == wavelets::boundary::periodic ? "periodic" : "symmetric");
+            report(label, ticks_per_hop(dn, signal, hops / 10));
+        }
+    }
+
+    return 0;
+}
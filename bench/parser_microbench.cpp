@@ -0,0 +1,103 @@
+// Lines per second through IMU::parse_one_quat_accg, against a plain
+// nlohmann::json DOM parse of the same lines (the previous implementation),
+// and samples per second decoded from the same data as binary frames.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "IMUreceiver.hpp"
+#include "wireFormat.hpp"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const long lines = (argc > 1) ? std::atol(argv[1]) : 2000000;
+
+    // realistic phone lines: ~6-17 significant digits per value
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    std::vector<std::string> input(4096);
+    char buf[256];
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        std::snprintf(buf, sizeof(buf),
+                      "{\"t\":%.6f,\"quat\":[%.17g,%.17g,%.17g,%.17g],\"acc_g\":[%.9g,%.9g,%.9g]}",
+                      1.7e9 + 0.01 * static_cast<double>(i), u(rng), u(rng), u(rng), u(rng),
+                      u(rng), u(rng), u(rng));
+        input[i] = buf;
+    }
+
+    IMUsample sample;
+    volatile double sink = 0.0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < lines; ++i) {
+        IMU::parse_one_quat_accg(input[i % input.size()], sample);
+        sink = sink + sample.getAccG()[0];
+    }
+    const double fast = static_cast<double>(lines) / seconds_since(t0);
+
+    const long dom_lines = lines / 10;
+    t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < dom_lines; ++i) {
+        const auto j = nlohmann::json::parse(input[i % input.size()]);
+        sink = sink + j["acc_g"][0].get<double>();
+    }
+    const double dom = static_cast<double>(dom_lines) / seconds_since(t0);
+
+    // the same samples as binary frames of 100 records
+    std::vector<IMUsample> samples(input.size());
+    std::size_t text_bytes = 0;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        IMU::parse_one_quat_accg(input[i], samples[i]);
+        text_bytes += input[i].size() + 1;
+    }
+    double binary[3];
+    std::size_t binary_bytes[3];
+    const wire::encoding encs[3] = {wire::encoding::f64, wire::encoding::f32, wire::encoding::q16};
+    for (int e = 0; e < 3; ++e) {
+        std::string frames;
+        for (std::size_t i = 0; i < samples.size(); i += 100) {
+            wire::encode(&samples[i], std::min<std::size_t>(100, samples.size() - i), encs[e], 0, frames);
+        }
+        binary_bytes[e] = frames.size();
+
+        std::vector<IMUsample> out;
+        long decoded = 0;
+        t0 = std::chrono::steady_clock::now();
+        while (decoded < lines) {
+            for (std::size_t at = 0; at < frames.size();) {
+                wire::header h;
+                wire::read_header(frames.data() + at, h);
+                wire::decode(h, std::string_view(frames).substr(at + wire::header_size, h.length), out);
+                at += wire::header_size + h.length;
+                decoded += h.count;
+                sink = sink + out[0].getAccG()[0];
+            }
+        }
+        binary[e] = static_cast<double>(decoded) / seconds_since(t0);
+    }
+
+    std::printf("parse_one_quat_accg  %6.2f M lines/s\n", fast / 1e6);
+    std::printf("nlohmann::json DOM   %6.2f M lines/s\n", dom / 1e6);
+    const char* names[3] = {"f64", "f32", "q16"};
+    for (int e = 0; e < 3; ++e) {
+        std::printf("wire %s decode       %6.2f M samples/s, %5.1f B/sample (NDJSON %.1f)\n", names[e],
+                    binary[e] / 1e6, static_cast<double>(binary_bytes[e]) / samples.size(),
+                    static_cast<double>(text_bytes) / samples.size());
+    }
+    return 0;
+}
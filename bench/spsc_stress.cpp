@@ -0,0 +1,96 @@
+// Stress check for spscQueue: one producer and one consumer thread move
+// numbered items through a small queue in random batch sizes. Every item must
+// arrive exactly once, in order, with all of its fields from the same push.
+// Exits non-zero on the first lost, repeated or torn item.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "spscQueue.hpp"
+
+namespace {
+
+// Fields derived from seq, so a mix of two pushes cannot pass the check
+struct item {
+    std::uint64_t seq;
+    std::uint64_t mul;
+    std::uint64_t inv;
+    float x, y;
+};
+
+item make_item(std::uint64_t seq) {
+    return {seq, seq * 0x9E3779B97F4A7C15ull, ~seq, static_cast<float>(seq & 0xffff),
+            -static_cast<float>(seq & 0xffff)};
+}
+
+bool same(const item& a, const item& b) {
+    return a.seq == b.seq && a.mul == b.mul && a.inv == b.inv && a.x == b.x && a.y == b.y;
+}
+
+// Small, so both the full and the empty paths are hit constantly
+using queue_t = spscQueue<item, 256>;
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::uint64_t total = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+
+    static queue_t q;
+    constexpr int max_batch = 300;  // larger than the queue on purpose
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    std::thread producer([total] {
+        std::mt19937 rng(1);
+        item batch[max_batch];
+        std::uint64_t next = 0;
+        while (next < total) {
+            const int want = static_cast<int>(std::min<std::uint64_t>(rng() % max_batch + 1, total - next));
+            for (int i = 0; i < want; ++i) batch[i] = make_item(next + i);
+            std::size_t done = 0;
+            while (done < static_cast<std::size_t>(want)) {
+                const std::size_t n = q.push(batch + done, want - done);
+                if (n == 0) std::this_thread::yield();
+                done += n;
+            }
+            next += want;
+        }
+    });
+
+    std::mt19937 rng(2);
+    item batch[max_batch];
+    std::uint64_t expect = 0;
+    bool ok = true;
+    while (ok && expect < total) {
+        const std::size_t n = q.pop(batch, rng() % max_batch + 1);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (std::size_t i = 0; i < n; ++i, ++expect) {
+            if (!same(batch[i], make_item(expect))) {
+                std::fprintf(stderr, "item %llu: got seq %llu (lost, repeated or torn)\n",
+                             static_cast<unsigned long long>(expect),
+                             static_cast<unsigned long long>(batch[i].seq));
+                ok = false;
+                break;
+            }
+        }
+    }
+    if (!ok) {
+        // the producer may be stuck on a full queue
+        std::_Exit(1);
+    }
+    producer.join();
+
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("spscQueue: %llu items in order, none lost or torn, %.1f M items/s\n",
+                static_cast<unsigned long long>(total), total / s / 1e6);
+    return q.size() == 0 ? 0 : 1;
+}
@@ -1,13 +1,25 @@
 #pragma once
 
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "GPSsample.hpp"
+#include "metrics.hpp"
+#include "sampleSink.hpp"
+#include "sessionFile.hpp"
+#include "wireFormat.hpp"
 
 // Keep these macros consistent with receiver.cpp / IMUserver.cpp usage.
+// MAX is the default read size: large enough for one read to drain a
+// full socket receive buffer.
 #ifndef MAX
-#define MAX 1024
+#define MAX (64 * 1024)
 #endif
 
+// Default listening port; the servers take another with -p [host:]port
 #ifndef PORT
 #define PORT 7777
 #endif
@@ -17,6 +29,40 @@
 #endif
 
 namespace GPS{
-    bool parse_GPS(const std::string& line, GPSsample& out);
-    void process(int connfd);
+    bool parse_GPS(std::string_view line, GPSsample& out);
+
+    // One client's stream: each line that parses is passed to `out`.
+    class session {
+    public:
+        explicit session(sampleSink& out) : out_(out) {}
+
+        // Bytes of one read, before framing (counted only)
+        void on_read(std::size_t bytes) { stats_.add(metrics::counter::bytes, bytes); }
+        void on_line(std::string_view line);
+        // A binary frame (wireFormat.hpp) of GPS samples
+        void on_frame(const wire::header& h, std::string_view payload);
+
+        // Also append the samples to a session file (sessionFile.hpp);
+        // false if it cannot be created.
+        bool record(const std::string& path);
+        // Or to one already open, shared with the connection's IMU::session
+        void record(std::shared_ptr<sessionRecorder> rec) { rec_ = std::move(rec); }
+        // End of a burst; nothing is held back
+        void flush() {}
+
+        const metrics::connection& stats() const { return stats_; }
+
+    private:
+        sampleSink& out_;
+        metrics::connection stats_{"gps"};
+        std::vector<GPSsample> frame_;
+        std::shared_ptr<sessionRecorder> rec_;
+
+        void on_sample_(const GPSsample& sample);
+    };
+
+    // record_path: as session::record, if not null. Output goes to `out`
+    // (a writer of its own on stdout if null) in the given format.
+    void process(int connfd, std::size_t read_size = MAX, const char* record_path = nullptr,
+                 asyncWriter* out = nullptr, sinkFormat format = sinkFormat::text);
 }
\ No newline at end of file
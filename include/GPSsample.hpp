@@ -1,3 +1,7 @@
+#pragma once
+
+#include <iosfwd>
+
 class GPSsample{
 public:
     GPSsample() = default;
@@ -15,6 +19,17 @@ public:
     // t_gps is the time from gps subsystem
     void setTGPS(double t_gps);
 
+    // getters
+    double getTime() const;
+    double getLatitude() const;
+    double getLongitude() const;
+    double getAltitude() const;
+    double getHAcc() const;
+    double getVAcc() const;
+    double getSpeed() const;
+    double getCourse() const;
+    double getTGPS() const;
+
     friend std::ostream& operator<<(std::ostream& os, const GPSsample& sample);
 
 private:
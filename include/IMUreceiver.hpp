@@ -1,13 +1,32 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "IMUsample.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
+#include "resampler.hpp"
+#include "sampleSink.hpp"
+#include "sessionFile.hpp"
+#include "waveletDenoiser.hpp"
+#include "wireFormat.hpp"
+#include "worldFrame.hpp"
 
 // Keep these macros consistent with receiver.cpp / IMUserver.cpp usage.
+// MAX is the default read size: large enough for one read to drain a
+// full socket receive buffer.
 #ifndef MAX
-#define MAX 1024
+#define MAX (64 * 1024)
 #endif
 
+// Default listening port; the servers take another with -p [host:]port
 #ifndef PORT
 #define PORT 8888
 #endif
@@ -17,6 +36,69 @@
 #endif
 
 namespace IMU{
-    bool parse_one_quat_accg(const std::string& line, IMUsample& out);
-    void process(int connfd);
+    // Fast single-pass parse, nlohmann::json for any other layout
+    bool parse_one_quat_accg(std::string_view line, IMUsample& out);
+    // Denoiser options shared by every consumer of the live stream
+    void setup_denoiser(denoiser<>& dn);
+
+    // Optional stages between parsing and the denoiser, in this order
+    struct pipeline {
+        std::optional<resampler::options> grid;   // onto a fixed-rate grid
+        std::optional<worldFrame::options> world; // world-frame linear acceleration
+    };
+
+    // One client's stream: each line is parsed, passed to `out` and pushed
+    // through its own denoiser; denoised hop samples go to `out` as well,
+    // with the time of the input each one is the denoised value of.
+    class session {
+    public:
+        explicit session(sampleSink& out);
+
+        // Bytes of one read, before framing (counted only)
+        void on_read(std::size_t bytes) { stats_.add(metrics::counter::bytes, bytes); }
+        void on_line(std::string_view line);
+        // A binary frame (wireFormat.hpp) of IMU samples
+        void on_frame(const wire::header& h, std::string_view payload);
+
+        // Stages ahead of the denoiser; raw samples still go to `out` as
+        // received. Set before the first sample. A gap in the grid restarts
+        // the denoiser, so no window spans it; gaps and dropped samples are
+        // counted in stats().
+        void configure(const pipeline& p);
+        // End of a burst: runs what is queued for the world-frame stage
+        void flush();
+
+        // Also append raw and denoised samples to a session file
+        // (sessionFile.hpp); false if it cannot be created.
+        bool record(const std::string& path);
+        // Or to one already open, shared with the connection's GPS::session
+        void record(std::shared_ptr<sessionRecorder> rec) { rec_ = std::move(rec); }
+
+        const metrics::connection& stats() const { return stats_; }
+
+    private:
+        sampleSink& out_;
+        denoiser<> dn_;
+        std::optional<resampler> grid_;
+        std::unique_ptr<worldFrame> world_;  // 4 KiB of queue, only with -g
+        metrics::connection stats_{"imu"};
+        std::vector<IMUsample> frame_;
+        std::shared_ptr<sessionRecorder> rec_;
+        // arrival time of the last windowSize pushes (IMU_LATENCY only)
+        std::array<latency::tick, latency::enabled ? denoiser<>::windowSize : 1> arrivals_{};
+        std::uint64_t pushed_ = 0;
+
+        void on_sample_(const IMUsample& sample);
+        void accel_(double t, double x, double y, double z);
+        void restart_denoiser_();
+        void run_world_();
+        void denoise_(double t, double x, double y, double z);
+        void record_end_to_end_();
+    };
+
+    // record_path: as session::record, if not null. Output goes to `out`
+    // (a writer of its own on stdout if null) in the given format.
+    void process(int connfd, std::size_t read_size = MAX, const char* record_path = nullptr,
+                 asyncWriter* out = nullptr, sinkFormat format = sinkFormat::text,
+                 const pipeline& stages = pipeline());
 }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Writes to a file descriptor from a background thread, so the threads
+// producing output never wait on a slow terminal or pipe.
+//
+// Producers copy whole batches of formatted records into a preallocated
+// byte ring; the writer thread empties it with one writev per pass (two
+// iovecs when the data wraps), however many batches piled up meanwhile.
+// Batches never interleave. When the ring is full, policy::block makes
+// write() wait for room (backpressure) and policy::drop discards the batch
+// and counts it.
+//
+// A tap sees the same bytes, on the writer thread, just before they go to
+// the fd; with fd < 0 the tap is the only output. It gets whole batches,
+// one or two pieces of ring per call, and no more than tap_bytes per call
+// unless a single batch is larger (or larger than the ring, in which case
+// it comes in the pieces write() queued it in).
+class asyncWriter {
+public:
+    enum class policy { block, drop };
+    struct span {
+        const char* p;
+        std::size_t n;
+    };
+    using tap = std::function<void(const span* pieces, int count)>;
+    static constexpr std::size_t tap_bytes = 64 * 1024;
+
+    // capacity is rounded up to a power of two
+    explicit asyncWriter(int fd, std::size_t capacity = std::size_t(4) << 20,
+                         policy p = policy::block);
+    // Writes out what is buffered, then stops the thread
+    ~asyncWriter();
+
+    asyncWriter(const asyncWriter&) = delete;
+    asyncWriter& operator=(const asyncWriter&) = delete;
+
+    // Queues [p, p + n). Any thread. False if the batch was dropped.
+    bool write(const char* p, std::size_t n);
+    // Waits until everything queued so far has been written
+    void flush();
+    // Set before the first write()
+    void set_tap(tap t) { tap_ = std::move(t); }
+
+    std::uint64_t written_bytes() const { return written_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped_bytes() const { return dropped_bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped_batches() const { return dropped_batches_.load(std::memory_order_relaxed); }
+    // Bytes queued but not written yet, out of capacity()
+    std::size_t buffered_bytes() const { return buffered_.load(std::memory_order_relaxed); }
+    std::size_t capacity() const { return ring_.size(); }
+
+private:
+    int fd_;
+    policy policy_;
+    tap tap_;
+    std::vector<char> ring_;
+    std::size_t mask_;
+
+    std::mutex producers_;          // one batch at a time
+    std::mutex lock_;               // head_, tail_, stop_
+    std::condition_variable data_;  // writer waits for data
+    std::condition_variable space_; // producers and flush() wait for the writer
+    std::uint64_t head_ = 0;        // bytes queued
+    std::uint64_t tail_ = 0;        // bytes written (or given up on)
+    std::deque<std::uint64_t> ends_;  // head_ after each batch, with a tap
+    bool stop_ = false;
+    bool failed_ = false;           // writer thread only
+
+    std::atomic<std::uint64_t> written_{0}, dropped_bytes_{0}, dropped_batches_{0};
+    std::atomic<std::size_t> buffered_{0};  // head_ - tail_, for readers without lock_
+    std::thread th_;
+
+    void run_();
+    void write_out_(std::uint64_t from, std::uint64_t to);
+    void tap_out_(std::uint64_t from, std::uint64_t to);
+};
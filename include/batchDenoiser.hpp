@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "waveletDenoiser.hpp"
+
+// Runs the same Haar/threshold/WOLA pipeline as `denoiser`, but for many
+// independent streams at once. Streams are grouped in tiles of `lanes`
+// streams stored structure-of-arrays ([tile][sample][lane]), so each step of
+// the transform works on one vector of lanes at a time (AVX2/AVX-512) and a
+// tile's whole state is a few contiguous kilobytes.
+//
+// Output is bit-identical to a per-stream `denoiser<>` fed the same samples.
+// IMU_DENOISE_NATIVE enables the wide instruction sets, but may also let the
+// compiler fuse a multiply-add in the scalar path (results then agree to ~1 ulp).
+class batchDenoiser {
+public:
+    static constexpr int windowSize = denoiser<>::windowSize;
+    static constexpr int levels     = denoiser<>::levels;
+    static constexpr int hop        = denoiser<>::hop;
+
+    // 8 doubles = one AVX-512 register, two AVX2 registers.
+    static constexpr int lanes = 8;
+
+    explicit batchDenoiser(int streams);
+
+    int streams() const { return streams_; }
+
+    void push(int stream, double t, double ax, double ay, double az);
+
+    // Runs one hop for every stream that has enough new samples.
+    // Returns how many streams emitted hop samples this call.
+    int denoise();
+
+    // True when `stream` emitted on the last denoise() call.
+    bool emitted(int stream) const { return emitted_[stream] != 0; }
+
+    // Access last emitted hop samples of one stream
+    const double* out_x(int stream) const { return &out_x_[stream * hop]; }
+    const double* out_y(int stream) const { return &out_y_[stream * hop]; }
+    const double* out_z(int stream) const { return &out_z_[stream * hop]; }
+
+private:
+    using tile_t = double[lanes];
+
+    int streams_;
+    int tiles_;
+
+    // -------- input ring buffers, [tile][windowSize][lanes] --------
+    // Same bookkeeping as denoiser, one slot per stream. Streams that are fed
+    // in lockstep share idx, which lets a tile read each ring row as one vector.
+    std::vector<double> t_, ax_, ay_, az_;
+    std::vector<int> idx_;         // oldest sample position per stream
+    std::vector<int> count_;       // samples received (cap at windowSize)
+    std::vector<int> hop_counter_; // samples since last denoise
+
+    // -------- WOLA state, [tile][windowSize][lanes] --------
+    std::array<double, windowSize> win_{};
+    std::vector<double> ola_x_acc_, ola_x_wsum_;
+    std::vector<double> ola_y_acc_, ola_y_wsum_;
+    std::vector<double> ola_z_acc_, ola_z_wsum_;
+
+    // emitted hop samples, [stream][hop]
+    std::vector<double> out_x_, out_y_, out_z_;
+    std::vector<unsigned char> emitted_;
+
+    static std::size_t slot_(int row, int stream) {
+        return (static_cast<std::size_t>(stream / lanes) * windowSize + row) * lanes + stream % lanes;
+    }
+    bool ready_(int stream) const;
+
+    // -------- per-tile kernels --------
+    void haar_dwt_(const double* ring, const int* idx, tile_t* w) const;
+    void haar_idwt_(tile_t* w) const;
+    void threshold_(tile_t* w) const;
+    void add_block_wola_(double* acc, double* wsum, const tile_t* block,
+                         const bool* mask) const;
+
+    void denoise_tile_(int tile, const bool* mask);
+};
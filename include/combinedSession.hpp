@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "GPSreceiver.hpp"
+#include "IMUreceiver.hpp"
+#include "ingestServer.hpp"
+#include "streamJoin.hpp"
+
+// IMU and GPS on one connection (IMU_ingest): each message goes to the
+// connection's IMU::session or GPS::session by its type.
+//
+//   binary frames  by the kind in their header
+//   NDJSON lines   by a "type":"imu" or "type":"gps" member, or, untagged,
+//                  by shape: a "quat" key makes an IMU line, "lat" a GPS one
+//
+// Lines of neither kind go to the IMU session, which counts them as parse
+// errors. Both sessions write to one formatSink, so the connection's output
+// leaves in arrival order and in one piece per burst, as with
+// bufferedSession. Bytes are counted per message, on the session it went to.
+//
+// With join(), the connection's raw IMU samples and fixes also go through
+// a streamJoin, and each IMU sample gets a joined record (formatSink::
+// joined) once the GPS state at its time is known: in time order, a
+// little after the sample itself.
+enum class messageType { unknown, imu, gps };
+
+messageType classify_line(std::string_view line);
+
+class combinedSession : public ingestServer::handler {
+public:
+    explicit combinedSession(asyncWriter* out, sinkFormat format = sinkFormat::text)
+        : sink_(out, format), tap_(*this), imu_(tap_), gps_(tap_) {}
+    ~combinedSession() override;
+
+    void on_line(std::string_view line) override;
+    void on_frame(const wire::header& h, std::string_view payload) override;
+    void on_idle() override;
+
+    // Both streams into one session file; false if it cannot be created
+    bool record(const std::string& path);
+    // Join the two streams from now on (see above)
+    void join(const streamJoin::options& o) { join_ = std::make_unique<streamJoin>(o); }
+    const streamJoin* joiner() const { return join_.get(); }
+
+    IMU::session& imu() { return imu_; }
+    GPS::session& gps() { return gps_; }
+
+private:
+    // Between the sessions and sink_: passes everything on and feeds the join
+    class joinTap : public sampleSink {
+    public:
+        explicit joinTap(combinedSession& c) : c_(c) {}
+        void imu(const IMUsample& s) override;
+        void denoised(double t, double x, double y, double z) override {
+            c_.sink_.denoised(t, x, y, z);
+        }
+        void gps(const GPSsample& s) override;
+
+    private:
+        combinedSession& c_;
+    };
+
+    formatSink sink_;
+    joinTap tap_;
+    std::unique_ptr<streamJoin> join_;  // ~18 KiB, only with join()
+    IMU::session imu_;
+    GPS::session gps_;
+
+    void drain_join_();
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+// Dense R x C matrix of doubles with its size fixed at compile time, for
+// the small filters (fusionEngine.hpp). Row-major, stored in place: no
+// heap, copies are memcpy, and the loops unroll for the sizes in use.
+template <int R, int C>
+struct fixedMatrix {
+    static constexpr int rows = R;
+    static constexpr int cols = C;
+
+    std::array<double, R * C> a{};
+
+    double& operator()(int r, int c) { return a[r * C + c]; }
+    double operator()(int r, int c) const { return a[r * C + c]; }
+
+    static fixedMatrix identity() {
+        static_assert(R == C, "identity of a non-square matrix");
+        fixedMatrix m;
+        for (int i = 0; i < R; ++i) m(i, i) = 1.0;
+        return m;
+    }
+
+    fixedMatrix<C, R> transposed() const {
+        fixedMatrix<C, R> t;
+        for (int i = 0; i < R; ++i)
+            for (int j = 0; j < C; ++j) t(j, i) = (*this)(i, j);
+        return t;
+    }
+
+    fixedMatrix& operator+=(const fixedMatrix& b) {
+        for (int i = 0; i < R * C; ++i) a[i] += b.a[i];
+        return *this;
+    }
+    fixedMatrix& operator-=(const fixedMatrix& b) {
+        for (int i = 0; i < R * C; ++i) a[i] -= b.a[i];
+        return *this;
+    }
+};
+
+template <int R, int K, int C>
+fixedMatrix<R, C> operator*(const fixedMatrix<R, K>& x, const fixedMatrix<K, C>& y)
+{
+    fixedMatrix<R, C> m;
+    for (int i = 0; i < R; ++i)
+        for (int k = 0; k < K; ++k) {
+            const double v = x(i, k);
+            for (int j = 0; j < C; ++j) m(i, j) += v * y(k, j);
+        }
+    return m;
+}
+
+template <int R, int C>
+fixedMatrix<R, C> operator+(fixedMatrix<R, C> x, const fixedMatrix<R, C>& y) { return x += y; }
+
+template <int R, int C>
+fixedMatrix<R, C> operator-(fixedMatrix<R, C> x, const fixedMatrix<R, C>& y) { return x -= y; }
+
+// Inverts m in place by Gauss-Jordan with partial pivoting; false (m then
+// undefined) if it is singular to working precision.
+template <int N>
+bool invert(fixedMatrix<N, N>& m)
+{
+    fixedMatrix<N, N> inv = fixedMatrix<N, N>::identity();
+    for (int c = 0; c < N; ++c) {
+        int p = c;
+        for (int r = c + 1; r < N; ++r)
+            if (std::fabs(m(r, c)) > std::fabs(m(p, c))) p = r;
+        if (!(std::fabs(m(p, c)) > 1e-300)) return false;
+        if (p != c) {
+            for (int j = 0; j < N; ++j) {
+                std::swap(m(p, j), m(c, j));
+                std::swap(inv(p, j), inv(c, j));
+            }
+        }
+        const double d = 1.0 / m(c, c);
+        for (int j = 0; j < N; ++j) {
+            m(c, j) *= d;
+            inv(c, j) *= d;
+        }
+        for (int r = 0; r < N; ++r) {
+            if (r == c) continue;
+            const double f = m(r, c);
+            if (f == 0.0) continue;
+            for (int j = 0; j < N; ++j) {
+                m(r, j) -= f * m(c, j);
+                inv(r, j) -= f * inv(c, j);
+            }
+        }
+    }
+    m = inv;
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "GPSsample.hpp"
+#include "fixedMatrix.hpp"
+
+// IMU/GPS fusion: an error-state Kalman filter per device that integrates
+// denoised world-frame linear acceleration (worldFrame.hpp, in g) at the
+// IMU rate and corrects with GPS fixes, giving position and velocity at
+// the IMU rate.
+//
+// Nominal state: position and velocity in a local east/north/up frame
+// (metres, m/s) around the device's first fix, and an accelerometer bias.
+// The error state is the same nine quantities; orientation comes from the
+// phone's quaternion upstream, so all of it is additive and the reset
+// after a correction leaves the covariance as it is. World x, y, z are
+// taken to be east, north, up.
+//
+// A fix corrects position with hAcc (horizontal) and vAcc (vertical) as
+// its standard deviations, and horizontal velocity from speed and course
+// when both are valid (not negative). Fixes are applied in arrival order
+// at the filter's current time; one newer than the last IMU sample first
+// coasts the filter up to it.
+//
+// predict() and correct() work on fixed-size matrices on the stack and
+// never allocate.
+class fusionFilter {
+public:
+    static constexpr int N = 9;   // error state: position, velocity, bias
+    using matrix = fixedMatrix<N, N>;
+
+    struct options {
+        double accel_noise = 0.5;   // m/s^2 / sqrt(Hz), on the denoised acceleration
+        double bias_walk = 0.01;    // m/s^2 / sqrt(s), bias random walk
+        double speed_noise = 0.5;   // m/s, per horizontal component of speed/course
+        double max_dt = 0.1;        // s; longer IMU gaps coast at constant velocity
+    };
+
+    struct state {
+        double t = 0;
+        double p[3] = {};     // m east, north, up of the origin
+        double v[3] = {};     // m/s
+        double bias[3] = {};  // m/s^2
+    };
+
+    explicit fusionFilter(const options& o) : opt_(o) {}
+
+    // World-frame linear acceleration (g) at time t. Ignored before the
+    // first fix and when t does not advance.
+    void predict(double t, double x, double y, double z);
+    // False if the fix was not used (no valid position or hAcc)
+    bool correct(const GPSsample& g);
+
+    bool ready() const { return ready_; }
+    const state& current() const { return x_; }
+    const matrix& covariance() const { return P_; }
+    // Current position as latitude, longitude (degrees) and altitude
+    void geodetic(double& lat, double& lon, double& alt) const;
+
+    std::uint64_t fixes() const { return fixes_; }
+    std::uint64_t rejected() const { return rejected_; }
+
+private:
+    options opt_;
+    bool ready_ = false;
+    state x_;
+    matrix P_;
+    double a_[3] = {};   // last bias-corrected acceleration, m/s^2
+
+    // local tangent plane at the first fix
+    double lat0_ = 0, lon0_ = 0, alt0_ = 0;
+    double m_per_rad_n_ = 0, m_per_rad_e_ = 0;
+
+    std::uint64_t fixes_ = 0, rejected_ = 0;
+
+    void start_(const GPSsample& g);
+    void propagate_(double dt);
+    template <int M>
+    bool update_(const fixedMatrix<M, N>& H, const double* innovation, const fixedMatrix<M, M>& R);
+};
+
+// fusionFilters keyed by device. A filter is created on the device's first
+// sample and stays put (callers may keep the reference) until remove().
+class fusionEngine {
+public:
+    using device_id = std::uint64_t;
+
+    explicit fusionEngine(const fusionFilter::options& o) : opt_(o) {}
+
+    fusionFilter& device(device_id id) { return devices_.try_emplace(id, opt_).first->second; }
+    void remove(device_id id) { devices_.erase(id); }
+    std::size_t devices() const { return devices_.size(); }
+
+    void imu(device_id id, double t, double x, double y, double z) { device(id).predict(t, x, y, z); }
+    bool gps(device_id id, const GPSsample& g) { return device(id).correct(g); }
+
+private:
+    fusionFilter::options opt_;
+    std::unordered_map<device_id, fusionFilter> devices_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Long history of one float channel with a decimation pyramid, for plotting
+// minutes to hours of samples at a cost set by the plot width.
+//
+// Samples are addressed by their absolute index (0 = first sample pushed).
+// The newest `capacity` samples are kept at full resolution; level k >= 1
+// holds one {min, max, mean} node per 4^k samples over the same span. push()
+// updates every level in O(1) amortized. Queries walk whole nodes of the
+// coarsest level that still gives each output column a few nodes, and drop
+// to finer levels only at the two edges of the range, so they touch
+// O(columns + levels) nodes however long the range is.
+class historyStore {
+public:
+    struct node {
+        float lo, hi, mean;
+    };
+
+    // capacity is rounded up to a power of four (at least 4).
+    explicit historyStore(std::size_t capacity = std::size_t(1) << 20);
+
+    void push(float v);
+    void push(const float* v, std::size_t n);
+
+    // Samples ever pushed; the newest has index size() - 1.
+    std::uint64_t size() const { return total_; }
+    // Oldest index still held
+    std::uint64_t first() const { return total_ > capacity_ ? total_ - capacity_ : 0; }
+    std::size_t capacity() const { return capacity_; }
+    int levels() const { return static_cast<int>(levels_.size()); }
+
+    // Coarsest level whose nodes are at most span / columns samples wide
+    int level_for(std::uint64_t span, int columns) const;
+
+    // min/max of [begin, end) in `columns` equal columns; x is the first
+    // sample index of each column. Returns the number of columns written
+    // (0 if nothing of the range is held).
+    std::size_t envelope(std::uint64_t begin, std::uint64_t end, int columns,
+                         std::vector<double>& x, std::vector<double>& lo,
+                         std::vector<double>& hi) const;
+
+    // At most `points` points along [begin, end), picked by
+    // largest-triangle-three-buckets from the level-mean series.
+    std::size_t lttb(std::uint64_t begin, std::uint64_t end, int points,
+                     std::vector<double>& x, std::vector<double>& y) const;
+
+private:
+    struct level {
+        std::vector<node> ring;   // complete nodes, by node index & mask
+        std::size_t mask = 0;
+        std::uint64_t done = 0;   // complete nodes so far
+        // node being filled
+        float lo = 0, hi = 0;
+        double sum = 0;
+        int filled = 0;
+    };
+
+    std::size_t capacity_;
+    std::vector<float> raw_;      // level 0, by sample index & (capacity_ - 1)
+    std::vector<level> levels_;   // levels_[k - 1] is level k
+    std::uint64_t total_ = 0;
+
+    // Calls f(first_index, span, node) for the nodes covering [begin, end)
+    // (inside the held range), in order, using level k inside and finer
+    // levels at the edges.
+    template <typename F>
+    void visit_(std::uint64_t begin, std::uint64_t end, int k, F&& f) const;
+
+    void carry_(int k, float lo, float hi, double sum);
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "sampleSink.hpp"
+#include "wireFormat.hpp"
+
+struct sockaddr_in;
+
+// Where a server listens, from the command line rather than the PORT
+// macros: "port" or "host:port", host a dotted IPv4 address.
+struct listenAddress {
+    std::string host;   // empty: all interfaces
+    int port = 0;
+
+    // Fills in from arg, keeping host if arg has none; false if arg is not
+    // [host:]port with port in 1..65535
+    bool parse(const char* arg);
+    // false (after a message) if host is not an IPv4 address
+    bool resolve(sockaddr_in& out) const;
+    // "host:port", or "*:port" for all interfaces
+    std::string str() const;
+};
+
+// Event-driven TCP server for many concurrent line-oriented clients.
+//
+// Sockets are non-blocking and watched by edge-triggered epoll. Each worker
+// thread owns one epoll set and every connection is only ever touched by its
+// worker, so per-connection state needs no locking. Every connection gets its
+// own lineFramer and its own handler from the factory, and may send NDJSON
+// lines, binary frames or both.
+//
+// By default worker 0 accepts and hands new connections out round robin.
+// With set_reuseport(true) every worker listens on its own SO_REUSEPORT
+// socket instead and the kernel spreads connections over them, so accepting
+// scales with the workers too (the factory is then called concurrently).
+//
+// Linux only; elsewhere start() fails and the servers keep their
+// one-client mode.
+class ingestServer {
+public:
+    // Per-connection consumer of complete lines; destroyed on disconnect
+    class handler {
+    public:
+        virtual ~handler() = default;
+        // Bytes of each read (or datagram), before framing
+        virtual void on_read(std::size_t) {}
+        virtual void on_line(std::string_view line) = 0;
+        // A binary frame (wireFormat.hpp) on the same connection
+        virtual void on_frame(const wire::header&, std::string_view) {}
+        // Called after each burst of reads, once the socket would block
+        virtual void on_idle() {}
+    };
+    // id is unique per accepted connection
+    using factory = std::function<std::unique_ptr<handler>(unsigned long id)>;
+
+    ingestServer(int port, factory make, int threads = 1, std::size_t read_size = 64 * 1024);
+    ~ingestServer();
+
+    ingestServer(const ingestServer&) = delete;
+    ingestServer& operator=(const ingestServer&) = delete;
+
+    // Options; set before start()
+    // Listen on this interface only (see listenAddress), not on all of them
+    void set_host(const std::string& host) { host_ = host; }
+    void set_reuseport(bool on) { reuseport_ = on; }
+    bool reuseport() const { return reuseport_; }
+    // Pin worker i to the i-th CPU the process may run on (worker 0 is the
+    // thread that calls run()).
+    void set_pin_cpus(bool on) { pin_cpus_ = on; }
+    bool pin_cpus() const { return pin_cpus_; }
+
+    // Binds and listens; false (after perror) on failure.
+    bool start();
+    // Serves until stop(); runs worker 0 on the calling thread.
+    void run();
+    // Makes run() return. Safe from any thread or a signal handler.
+    void stop();
+
+    long connections() const { return open_.load(std::memory_order_relaxed); }
+
+private:
+    struct connection;
+    struct worker {
+        int epfd = -1;
+        int listen_fd = -1;  // own socket with reuseport, else worker 0 only
+        std::thread th;
+        // open connections, so the loop can release them when it stops
+        std::mutex lock;
+        std::unordered_set<connection*> live;
+    };
+
+    int port_;
+    std::string host_;
+    factory make_;
+    std::size_t read_size_;
+    bool reuseport_ = false;
+    bool pin_cpus_ = false;
+    int wake_fd_ = -1;
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::atomic<unsigned long> next_id_{0};
+    std::atomic<long> open_{0};
+
+    // epoll data.ptr tags for the two non-connection fds
+    char listen_tag_ = 0;
+    char wake_tag_ = 0;
+
+    int listen_socket_() const;
+    void pin_(int w) const;
+    void loop_(int w);
+    void accept_all_(int w);
+    void serve_(connection* c);
+    void close_(connection* c);
+};
+
+// Adapts a per-stream session (IMU::session, GPS::session) to a handler. The
+// session formats into a private batch that goes to `out` in one piece
+// after each burst, so output of concurrent clients never mixes mid-record.
+// A null writer turns all output off.
+template <typename Session>
+class bufferedSession : public ingestServer::handler {
+public:
+    explicit bufferedSession(asyncWriter* out, sinkFormat format = sinkFormat::text)
+        : sink_(out, format), session_(sink_) {}
+    ~bufferedSession() override { on_idle(); }
+
+    void on_read(std::size_t bytes) override { session_.on_read(bytes); }
+    void on_line(std::string_view line) override { session_.on_line(line); }
+    void on_frame(const wire::header& h, std::string_view payload) override {
+        session_.on_frame(h, payload);
+    }
+    void on_idle() override {
+        session_.flush();
+        sink_.flush();
+    }
+
+    Session& session() { return session_; }
+    // See Session::record
+    bool record(const std::string& path) { return session_.record(path); }
+
+private:
+    formatSink sink_;
+    Session session_;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Per-stage latency histograms for the ingest pipeline.
+//
+// Built with -DIMU_LATENCY (CMake option IMU_LATENCY), every call below
+// takes a steady_clock timestamp or adds one value to a histogram owned by
+// the calling thread, so recording never contends. Without it, `enabled` is
+// false, now() returns 0 and record() is empty: the calls compile away.
+//
+// Histograms are HDR-style: exact below 64 ns, then 32 linear buckets per
+// power of two (about 3% resolution) up to about 36 minutes, in a fixed
+// 9.5 KiB per stage. report() merges all threads' histograms.
+namespace latency {
+
+#ifdef IMU_LATENCY
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+// Stages a sample goes through, in order
+enum class stage : int {
+    read,        // one read(2) / recvmmsg of socket data
+    frame,       // finding one message in the read buffer
+    parse,       // one NDJSON line, or one binary frame
+    push,        // denoiser::push of one sample
+    denoise,     // one denoise() that emits a hop
+    emit,        // handing a hop to the output (or to the plot queue)
+    plot,        // viewer: published by the receiver until the UI drains it
+    end_to_end,  // socket arrival of a sample until its denoised output
+    count
+};
+
+const char* name(stage s);
+
+using tick = std::uint64_t;  // steady_clock nanoseconds
+
+class histogram {
+public:
+    static constexpr int sub_bits = 5;
+    static constexpr int buckets = 64 + 35 * 32;
+
+    void record(tick v);
+    // Adds o's counts to this one (o may still be recording)
+    void merge(const histogram& o);
+
+    std::uint64_t count() const;
+    tick max() const { return max_.load(std::memory_order_relaxed); }
+    // Upper edge of the bucket holding the q-quantile (0 <= q <= 1)
+    tick quantile(double q) const;
+
+private:
+    // one writer thread; relaxed atomics so report() may read concurrently
+    std::array<std::atomic<std::uint64_t>, buckets> counts_{};
+    std::atomic<tick> max_{0};
+
+    static int index_(tick v);
+    static tick upper_(int i);
+};
+
+// Histograms of the calling thread (created on first use)
+histogram* thread_histograms();
+
+inline tick now()
+{
+    if constexpr (enabled) {
+        return static_cast<tick>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    } else {
+        return 0;
+    }
+}
+
+// Adds now() - since to the stage's histogram
+inline void record(stage s, tick since)
+{
+    if constexpr (enabled) {
+        thread_histograms()[static_cast<int>(s)].record(now() - since);
+    }
+}
+
+// Arrival time of the data the calling thread is handling: readers mark it
+// after each read, sessions use it for end_to_end.
+inline thread_local tick arrival = 0;
+inline void mark_arrival()
+{
+    if constexpr (enabled) arrival = now();
+}
+
+// p50/p99/p999/max per stage over all threads so far, one line each
+void report(std::FILE* out);
+
+// Asks the reporter thread for a report soon. Signal-safe.
+void request_report();
+// Reports to stderr every `seconds` (0: only when requested) from a
+// background thread, until the process exits.
+void start_reporter(int seconds);
+
+} // namespace latency
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+// Splits a byte stream into '\n'-terminated lines without copying them.
+//
+// Bytes are read straight into one fixed buffer of read_size + max_line
+// bytes. Complete lines come back as views into that buffer; only the
+// trailing partial line is ever moved, and only when the free space drops
+// below read_size. A line longer than max_line is dropped up to and
+// including its newline (counted in dropped()).
+//
+// Views returned by next() stay valid until the next read_from().
+class lineFramer {
+public:
+    explicit lineFramer(std::size_t read_size = 64 * 1024, std::size_t max_line = 64 * 1024);
+
+    // One read(2) into the free space (at least read_size bytes); returns
+    // what read returned.
+    ssize_t read_from(int fd);
+    // The same from memory: copies what fits of [p, p + n) as one read
+    // would; returns the bytes taken.
+    std::size_t append(const char* p, std::size_t n);
+
+    // Next complete line, without '\n' or a trailing '\r'. May be empty.
+    bool next(std::string_view& line);
+
+    // Unconsumed bytes, starting where the next line would. Empty while an
+    // oversized line is being dropped. For framings mixed into the stream
+    // (see wireFormat.hpp); consume() removes n of them.
+    std::string_view peek() const;
+    void consume(std::size_t n);
+
+    std::size_t dropped() const { return dropped_; }
+    std::size_t buffered() const { return end_ - begin_; }
+
+private:
+    std::vector<char> buf_;
+    std::size_t read_size_;
+    std::size_t max_line_;
+
+    std::size_t begin_ = 0;  // start of the first unconsumed line
+    std::size_t scan_ = 0;   // bytes before this hold no '\n' past begin_
+    std::size_t end_ = 0;    // end of valid data
+    bool discarding_ = false;
+    std::size_t dropped_ = 0;
+
+    void compact_();
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Counters of the ingest pipeline, served in Prometheus text format.
+//
+// Every session owns a metrics::connection, written only by the thread
+// serving it with plain relaxed load/store pairs, so counting costs no
+// locked instruction. A scrape walks the open connections under a registry
+// lock that only connect and disconnect also take, and adds the counts
+// that closed connections left behind.
+namespace metrics {
+
+enum class counter : int {
+    bytes,         // bytes read from the client
+    lines,         // NDJSON lines (non-empty)
+    frames,        // binary frames
+    samples,       // samples parsed
+    parse_errors,  // lines or frames that did not parse
+    hops,          // denoiser hops emitted
+    denoised,      // denoised samples emitted
+    grid_gaps,     // resampler runs broken by a gap (-s)
+    grid_dropped,  // samples the resampler dropped as out of order (-s)
+    count
+};
+
+class connection {
+public:
+    // stream: label of the session kind ("imu", "gps"); must outlive this
+    explicit connection(const char* stream);
+    // Leaves its counts to the stream's totals
+    ~connection();
+
+    connection(const connection&) = delete;
+    connection& operator=(const connection&) = delete;
+
+    void add(counter c, std::uint64_t n = 1) {
+        auto& v = v_[static_cast<int>(c)];
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    std::uint64_t get(counter c) const { return v_[static_cast<int>(c)].load(std::memory_order_relaxed); }
+
+    const char* stream() const { return stream_; }
+    unsigned long id() const { return id_; }
+
+private:
+    const char* stream_;
+    unsigned long id_;
+    std::array<std::atomic<std::uint64_t>, static_cast<int>(counter::count)> v_{};
+};
+
+// A value owned elsewhere (a writer's fill level, say), read at scrape
+// time. read() runs on the endpoint thread.
+enum class kind { counter, gauge };
+void expose(const std::string& name, const std::string& help, kind k, std::function<double()> read);
+
+// Exposition text: totals per stream, then the exposed values; with
+// per_connection, every open connection's counters as well.
+std::string render(bool per_connection);
+
+// Serves render() over HTTP on a local endpoint: GET /metrics for the
+// totals, GET /metrics/connections with the per-connection breakdown.
+// Scrapes run on a thread of its own.
+class endpoint {
+public:
+    endpoint() = default;
+    ~endpoint() { stop(); }
+
+    endpoint(const endpoint&) = delete;
+    endpoint& operator=(const endpoint&) = delete;
+
+    // where: a TCP port on 127.0.0.1, or the path of a Unix socket.
+    // False (after perror) if it cannot listen.
+    bool start(const std::string& where);
+    void stop();
+
+private:
+    int fd_ = -1;
+    std::string unix_path_;
+    std::atomic<bool> stop_{false};
+    std::thread th_;
+
+    void run_();
+    void serve_(int fd) const;
+};
+
+} // namespace metrics
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "asyncWriter.hpp"
+
+// Lets any number of consumers (viewers, loggers, fusion) attach to a
+// server's output stream at once: each one that connects to the listening
+// socket gets every record from then on, in the server's output format.
+//
+// Records come from the asyncWriter's tap (see tap()), so sending never
+// holds up the sessions, in groups of whole batches of at most
+// asyncWriter::tap_bytes. A new consumer starts at a batch boundary. A
+// group goes to a consumer only once its socket buffer has room for all of
+// it (SO_MEMINFO against the SO_SNDBUF it actually got, on Linux); a
+// consumer that does not make room within 100 ms is disconnected rather
+// than slowing the others down further. A single batch larger than the
+// whole buffer goes to a consumer whose buffer is empty, with the same
+// 100 ms for each stall while it reads. Elsewhere, or should a send come up
+// short anyway, the consumer is disconnected after part of a group. Either
+// way the kernel may discard what the closed socket still held, so a
+// disconnected consumer can find its last record cut short.
+class outputFanout {
+public:
+    outputFanout() = default;
+    ~outputFanout() { stop(); }
+
+    outputFanout(const outputFanout&) = delete;
+    outputFanout& operator=(const outputFanout&) = delete;
+
+    // where: [host:]port over TCP (host 127.0.0.1 if left out), or the path
+    // of a Unix socket. False (after perror) if it cannot listen.
+    bool start(const std::string& where);
+    void stop();
+
+    // For asyncWriter::set_tap
+    asyncWriter::tap tap() {
+        return [this](const asyncWriter::span* pieces, int count) { send(pieces, count); };
+    }
+    void send(const asyncWriter::span* pieces, int count);
+
+    std::size_t consumers() const;
+    std::uint64_t disconnected_slow() const { return slow_.load(std::memory_order_relaxed); }
+
+private:
+    int fd_ = -1;
+    std::string unix_path_;
+    std::atomic<bool> stop_{false};
+    std::thread th_;
+
+    mutable std::mutex lock_;
+    std::vector<int> consumers_;
+    std::atomic<std::uint64_t> slow_{0};
+
+    void run_();
+    // Waits (briefly) until fits_(fd, n)
+    static bool room_(int fd, std::size_t n);
+    // Whether n more bytes fit in fd's socket buffer, or it is empty
+    static bool fits_(int fd, std::size_t n);
+    // Sends all of [p, p + n), waiting only while the consumer reads a
+    // batch larger than its buffer; false if it did not fit
+    static bool send_all_(int fd, const char* p, std::size_t n, bool& gone);
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Streaming resampler from irregular sample times onto a fixed-rate grid,
+// ahead of the denoiser (whose transform assumes uniform spacing).
+//
+// Grid points sit at whole multiples of 1 / rate, so grids of different
+// streams line up. Every push() emits the grid points between the previous
+// sample and this one; cubic mode interpolates one sample later, since a
+// segment's tangent needs the sample after it. Spacing above max_gap is a
+// gap: nothing is interpolated across it and the grid restarts at the next
+// sample. Timestamps that do not increase are dropped.
+//
+// Linear mode is the straight line between neighbours. Cubic mode is a
+// Hermite spline whose tangents are central differences over the actual
+// (uneven) spacing, and one-sided at the ends of a run.
+//
+// State is the last three samples and the next grid index: push() is O(1)
+// per grid point emitted and never allocates.
+class resampler {
+public:
+    enum class method { linear, cubic };
+
+    struct options {
+        double rate = 100.0;     // grid points per second
+        method how = method::linear;
+        double max_gap = 0.1;    // seconds
+    };
+
+    explicit resampler(const options& o) : opt_(o), period_(1.0 / o.rate) {}
+
+    const options& config() const { return opt_; }
+
+    // Feeds one sample; calls emit(t, x, y, z) for each grid point completed
+    template <typename F>
+    void push(double t, double x, double y, double z, F&& emit);
+
+    std::uint64_t gaps() const { return gaps_; }
+    std::uint64_t dropped() const { return dropped_; }
+
+private:
+    struct point {
+        double t;
+        double v[3];
+    };
+
+    options opt_;
+    double period_;
+    std::array<point, 3> hist_{};  // last samples of the current run, oldest first
+    int n_ = 0;
+    std::int64_t k_ = 0;           // next grid point is k_ * period_
+    std::uint64_t gaps_ = 0, dropped_ = 0;
+
+    // Grid points in [a.t, b.t); p0 / p3 are the neighbours, if any
+    template <typename F>
+    void segment_(const point* p0, const point& a, const point& b, const point* p3, F& emit);
+};
+
+template <typename F>
+void resampler::push(double t, double x, double y, double z, F&& emit)
+{
+    const point p{t, {x, y, z}};
+    const bool cubic = opt_.how == method::cubic;
+
+    if (n_ > 0) {
+        const point& last = hist_[n_ - 1];
+        if (!(t > last.t)) {
+            ++dropped_;
+            return;
+        }
+        if (t - last.t > opt_.max_gap) {
+            // finish the run: its last cubic segment was still waiting for p
+            if (cubic && n_ >= 2) segment_(n_ >= 3 ? &hist_[n_ - 3] : nullptr, hist_[n_ - 2], last, nullptr, emit);
+            ++gaps_;
+            n_ = 0;
+        }
+    }
+    if (n_ == 0) k_ = static_cast<std::int64_t>(std::ceil(t / period_));
+
+    if (!cubic && n_ >= 1) segment_(nullptr, hist_[n_ - 1], p, nullptr, emit);
+    if (cubic && n_ >= 2) segment_(n_ >= 3 ? &hist_[n_ - 3] : nullptr, hist_[n_ - 2], hist_[n_ - 1], &p, emit);
+
+    if (n_ == 3) {
+        hist_[0] = hist_[1];
+        hist_[1] = hist_[2];
+        --n_;
+    }
+    hist_[n_++] = p;
+}
+
+template <typename F>
+void resampler::segment_(const point* p0, const point& a, const point& b, const point* p3, F& emit)
+{
+    const bool cubic = opt_.how == method::cubic;
+    const double h = b.t - a.t;
+    double ma[3] = {}, mb[3] = {};
+    for (int i = 0; cubic && i < 3; ++i) {
+        const double slope = (b.v[i] - a.v[i]) / h;
+        ma[i] = p0 ? (b.v[i] - p0->v[i]) / (b.t - p0->t) : slope;
+        mb[i] = p3 ? (p3->v[i] - a.v[i]) / (p3->t - a.t) : slope;
+    }
+
+    for (double g = static_cast<double>(k_) * period_; g < b.t; g = static_cast<double>(++k_) * period_) {
+        const double u = (g - a.t) / h;
+        double v[3];
+        if (cubic) {
+            const double u2 = u * u, u3 = u2 * u;
+            const double h00 = 2 * u3 - 3 * u2 + 1, h10 = u3 - 2 * u2 + u;
+            const double h01 = -2 * u3 + 3 * u2, h11 = u3 - u2;
+            for (int i = 0; i < 3; ++i) v[i] = h00 * a.v[i] + h10 * h * ma[i] + h01 * b.v[i] + h11 * h * mb[i];
+        } else {
+            for (int i = 0; i < 3; ++i) v[i] = a.v[i] + u * (b.v[i] - a.v[i]);
+        }
+        emit(g, v[0], v[1], v[2]);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "GPSsample.hpp"
+#include "IMUsample.hpp"
+#include "asyncWriter.hpp"
+#include "streamJoin.hpp"
+
+// Where IMU::session and GPS::session put their output.
+class sampleSink {
+public:
+    virtual ~sampleSink() = default;
+
+    virtual void imu(const IMUsample& s) = 0;
+    // t is the time of the (raw or resampled) input sample this is the
+    // denoised value of
+    virtual void denoised(double t, double x, double y, double z) = 0;
+    virtual void gps(const GPSsample& s) = 0;
+    // End of a burst (one socket read): pass on what was produced
+    virtual void flush() {}
+};
+
+// Output formats of formatSink:
+//   text    as operator<< prints samples, and "x y z" lines for denoised
+//           output (6 significant digits)
+//   csv     "imu,t,qw,qx,qy,qz,ax,ay,az", "den,t,x,y,z",
+//           "gps,t,lat,lon,alt,hAcc,vAcc,speed,course,t_gps" and
+//           "join,t,t_gps,fix,lat,lon,alt,hAcc,vAcc,speed,course" lines,
+//           shortest round-trip digits; fix is 0 before the first fix, 1
+//           dead-reckoned from the last one, 2 interpolated
+//   binary  a tag byte (1 imu, 2 denoised, 3 gps, 4 join) followed by the
+//           same fields as float64, host byte order
+enum class sinkFormat { text, csv, binary };
+
+// "text", "csv" or "binary"; false for anything else
+bool parse_sink_format(const char* name, sinkFormat& f);
+
+// Formats records with std::to_chars into a private batch, which flush()
+// hands to an asyncWriter in one piece, so the output of concurrent
+// sessions never mixes mid-record. With a null writer nothing is formatted.
+class formatSink : public sampleSink {
+public:
+    explicit formatSink(asyncWriter* out, sinkFormat f = sinkFormat::text);
+    ~formatSink() override { flush(); }
+
+    void imu(const IMUsample& s) override;
+    void denoised(double t, double x, double y, double z) override;
+    void gps(const GPSsample& s) override;
+    // An IMU sample's GPS state (streamJoin.hpp), keyed by the sample's t
+    void joined(const streamJoin::joined& j);
+    void flush() override;
+
+private:
+    asyncWriter* out_;
+    sinkFormat format_;
+    std::string batch_;
+
+    // csv or binary record of n values
+    void record_(char tag, const char* csv_name, const double* v, int n);
+    void commit_(const char* p, std::size_t n);
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "asyncWriter.hpp"
+#include "IMUreceiver.hpp"
+#include "ingestServer.hpp"
+#include "metrics.hpp"
+#include "sampleSink.hpp"
+
+// What IMU_server, GPS_server and IMU_ingest share around their sessions:
+// the command line, the epoll and UDP serving loops, the metrics endpoint
+// and the reports on exit. Each main keeps only what differs per stream: its
+// session type and setup, its own options and its one-client mode.
+//
+// Options parsed here:
+// -m [n] [-r] [-c] [-q]
+//     serve any number of clients on n epoll threads; -r gives each thread
+//     its own SO_REUSEPORT listener, -c pins them to CPUs, -q stops the
+//     per-sample printing
+// -u [-q]
+//     receive datagrams (NDJSON or binary frames) from any number of
+//     senders on the same port over UDP; loss and reorder counts go to
+//     stderr on exit. Not with -m.
+// -p [host:]port
+//     listen on port of the interface with IPv4 address host, or of all
+//     interfaces
+// -o text|csv|binary
+//     output format (sampleSink.hpp); -d drops output that stdout cannot
+//     keep up with instead of slowing the clients down
+// -w path
+//     also record every session to a session file (sessionFile.hpp) for
+//     IMU_replay: path itself with one client, path.<n> for client n otherwise
+// -M port|path
+//     serve counters in Prometheus text format over HTTP on 127.0.0.1:port
+//     or a Unix socket: /metrics, and /metrics/connections per client
+// -l [seconds]
+//     per-stage latency percentiles (latency.hpp) to stderr every so many
+//     seconds, on SIGUSR1 and on exit; needs a build with IMU_LATENCY
+namespace driver {
+
+struct options {
+    listenAddress listen;   // -p [host:]port
+    bool many = false;      // -m: epoll server for any number of clients
+    int threads = 1;        // -m n: worker threads
+    bool reuseport = false; // -r: one SO_REUSEPORT listener per worker
+    bool pin = false;       // -c: pin workers to CPUs
+    bool quiet = false;     // -q: print nothing per sample
+    bool udp = false;       // -u: datagrams on the same port number
+    const char* record = nullptr;  // -w path: record sessions
+    sinkFormat format = sinkFormat::text;  // -o text|csv|binary
+    bool drop = false;      // -d: drop output that stdout cannot take
+    int latency = -1;       // -l [s]: latency report every s seconds
+    const char* metrics = nullptr;  // -M port|path: metrics endpoint
+    std::FILE* notices = stdout;    // "Server listening" and such
+
+    explicit options(int port) : listen{"", port} {}
+};
+
+enum class arg {
+    taken,  // one of the options above, i moved past its argument
+    other,  // not one of them: the caller's to parse
+    bad     // one of them with a bad argument, already reported
+};
+
+// Parses argv[i] if it is a shared option
+arg parse(int argc, char** argv, int& i, options& opt);
+// -s rate[:linear|:cubic] and -g, for the IMU pipeline
+arg parse(int argc, char** argv, int& i, IMU::pipeline& stages);
+
+// Once the command line is parsed: rejects option combinations that do
+// not go together and starts the latency reporter. False to exit.
+bool check(options& opt);
+
+// Sessions of type Handler, made with (out, format): a bufferedSession or
+// a combinedSession. setup(Handler&) configures each new one; with -w it
+// then records to <path>.<id>.
+template <typename Handler, typename Setup>
+ingestServer::factory sessions(const options& opt, asyncWriter* out, Setup setup)
+{
+    return [&opt, out, setup](unsigned long id) -> std::unique_ptr<ingestServer::handler> {
+        auto h = std::make_unique<Handler>(out, opt.format);
+        setup(*h);
+        if (opt.record) {
+            const std::string path = std::string(opt.record) + "." + std::to_string(id);
+            if (!h->record(path)) {
+                std::fprintf(stderr, "client %lu: cannot record to %s, serving it unrecorded\n", id,
+                             path.c_str());
+            }
+        }
+        return h;
+    };
+}
+
+// -m or -u: serves until SIGINT or SIGTERM, then flushes out and reports
+// as report() does. Returns the exit code.
+int serve(const options& opt, const ingestServer::factory& make, asyncWriter& out);
+
+// Exposes out's fill and drop counters and starts the endpoint at where
+// (-M); false (after a message) if it cannot listen
+bool serve_metrics(const char* where, const asyncWriter& out, metrics::endpoint& ep);
+
+// On exit: dropped output (-d) and the latency report (-l)
+void report(const options& opt, const asyncWriter& out);
+
+} // namespace driver
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GPSsample.hpp"
+#include "IMUsample.hpp"
+
+// Recorded sessions: raw IMU, denoised IMU and GPS samples in one chunked,
+// columnar file that is written and read through mmap.
+//
+// The file is a 4 KiB header page followed by fixed-size chunks. A chunk
+// holds up to chunk_rows rows of one stream, column by column (float64,
+// host byte order), behind a 64-byte chunk header:
+//
+//   off size
+//     0   4  chunk magic "CHK1"
+//     4   1  stream
+//     5   3  reserved (0)
+//     8   4  rows written
+//    16   8  t of the first row
+//    24   8  t of the last row
+//
+// Chunks of the three streams interleave in the order they were started;
+// only the last chunk of each stream is partly filled. The chunk headers
+// are the time index: a reader collects them per stream on open and finds
+// a timestamp by binary search over chunks, then within one chunk's t
+// column. The row count is stored after the row itself, so a file left by
+// a crashed recorder reads back up to the last complete row.
+namespace rec {
+
+enum class stream : std::uint8_t { imu = 1, denoised = 2, gps = 3 };
+constexpr int stream_count = 3;
+
+constexpr std::size_t chunk_rows = 4096;
+
+// Columns per row, t first:
+//   imu       t qw qx qy qz ax ay az
+//   denoised  t x y z      (t: the input sample the row is the denoised value of)
+//   gps       t lat lon alt hAcc vAcc speed course t_gps
+int columns(stream s);
+
+} // namespace rec
+
+class sessionRecorder {
+public:
+    sessionRecorder() = default;
+    ~sessionRecorder() { close(); }
+
+    sessionRecorder(const sessionRecorder&) = delete;
+    sessionRecorder& operator=(const sessionRecorder&) = delete;
+
+    // Creates (or truncates) path; false (after perror) on failure.
+    bool open(const std::string& path);
+    // Unmaps and trims the file to the chunks in use.
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    void imu(const IMUsample& s);
+    void denoised(double t, double x, double y, double z);
+    void gps(const GPSsample& s);
+
+    std::uint64_t rows(rec::stream s) const { return rows_[index_(s)]; }
+
+private:
+    struct chunk {
+        char* base = nullptr;   // mapping of the chunk, nullptr if none
+        std::uint32_t rows = 0;
+    };
+
+    int fd_ = -1;
+    std::uint64_t chunks_ = 0;    // chunks started
+    std::uint64_t reserved_ = 0;  // chunks the file has room for
+    chunk open_[rec::stream_count];
+    std::uint64_t rows_[rec::stream_count] = {};
+    bool failed_ = false;         // stop after the first I/O error
+
+    static int index_(rec::stream s) { return static_cast<int>(s) - 1; }
+    void append_(rec::stream s, const double* row);
+    bool start_chunk_(rec::stream s);
+    void seal_(chunk& c);
+};
+
+class sessionReader {
+public:
+    sessionReader() = default;
+    ~sessionReader();
+
+    sessionReader(const sessionReader&) = delete;
+    sessionReader& operator=(const sessionReader&) = delete;
+
+    // Maps path read-only; false (after a message) if it is not a session file.
+    bool open(const std::string& path);
+
+    std::uint64_t rows(rec::stream s) const;
+    // First row of s with t >= t (rows(s) if none), O(log rows). Assumes t
+    // does not decrease along the stream, as recorded from one phone.
+    std::uint64_t seek(rec::stream s, double t) const;
+
+    double time(rec::stream s, std::uint64_t row) const { return value(s, row, 0); }
+    double value(rec::stream s, std::uint64_t row, int column) const;
+    IMUsample imu(std::uint64_t row) const;
+    GPSsample gps(std::uint64_t row) const;
+
+private:
+    struct index {
+        std::vector<const char*> chunks;        // chunk bases, in order
+        std::vector<std::uint64_t> first_row;   // of each chunk, plus the total
+        std::vector<double> first_t;            // of each chunk
+    };
+
+    const char* map_ = nullptr;
+    std::size_t size_ = 0;
+    index streams_[rec::stream_count];
+
+    const index& index_(rec::stream s) const { return streams_[static_cast<int>(s) - 1]; }
+    // Chunk holding row, and the row's offset in it
+    std::size_t locate_(const index& ix, std::uint64_t row, std::uint32_t& at) const;
+};
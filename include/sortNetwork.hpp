@@ -0,0 +1,59 @@
+#pragma once
+
+// Bitonic sorting networks for small power-of-two arrays. The comparison
+// sequence is fixed, so there are no data-dependent branches, and V can be
+// a scalar or a vector type (lanes are then sorted independently) as long as
+// Swap is a compare-exchange for it.
+namespace sortnet {
+
+// Compare-exchange: a <- min(a, b), b <- max(a, b)
+struct cmpswap {
+    template <typename V>
+    void operator()(V& a, V& b) const {
+        const V lo = (b < a) ? b : a;
+        const V hi = (b < a) ? a : b;
+        a = lo;
+        b = hi;
+    }
+};
+
+namespace detail {
+    // One bitonic stage: compare elements J apart. Direction only changes
+    // every K elements (K >= 2J), so each run of J pairs is branch free and
+    // lays out as contiguous min/max the compiler can vectorize.
+    template <int N, int K, int J, typename V, typename Swap>
+    inline void stage(V* v, Swap& swap) {
+        for (int base = 0; base < N; base += 2 * J) {
+            V* lo = v + base;
+            V* hi = v + base + J;
+            if ((base & K) == 0) {
+                for (int i = 0; i < J; ++i) swap(lo[i], hi[i]);
+            } else {
+                for (int i = 0; i < J; ++i) swap(hi[i], lo[i]);
+            }
+        }
+        if constexpr (J > 1) stage<N, K, J / 2>(v, swap);
+    }
+
+    template <int N, int K, typename V, typename Swap>
+    inline void sort_from(V* v, Swap& swap) {
+        stage<N, K, K / 2>(v, swap);
+        if constexpr (K < N) sort_from<N, K * 2>(v, swap);
+    }
+}
+
+// Sort v[0, N) ascending. N must be a power of two.
+template <int N, typename V, typename Swap = cmpswap>
+inline void bitonic_sort(V* v, Swap swap = Swap{}) {
+    static_assert(N >= 1 && (N & (N - 1)) == 0, "bitonic_sort needs a power-of-two length");
+    if constexpr (N > 1) detail::sort_from<N, 2>(v, swap);
+}
+
+// Sort a bitonic v[0, N) (ascending then descending) ascending.
+template <int N, typename V, typename Swap = cmpswap>
+inline void bitonic_merge(V* v, Swap swap = Swap{}) {
+    static_assert(N >= 1 && (N & (N - 1)) == 0, "bitonic_merge needs a power-of-two length");
+    if constexpr (N > 1) detail::stage<N, 2 * N, N / 2>(v, swap);
+}
+
+} // namespace sortnet
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Items are copied in and out in batches; neither side ever waits for
+// the other. A full queue makes push() accept fewer items, so the producer
+// decides what to do with the rest.
+//
+// head_ and tail_ only ever grow (wrapping is harmless with a power-of-two
+// Capacity). Each side keeps a cached copy of the other side's index in its
+// own cache line and rereads the shared one only when the cache says the
+// queue is full (producer) or empty (consumer).
+template <typename T, std::size_t Capacity>
+class spscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "spscQueue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "spscQueue items are copied as plain data");
+
+public:
+    static constexpr std::size_t capacity = Capacity;
+
+    // -------- producer --------
+    // Appends up to n items; returns how many fit.
+    std::size_t push(const T* items, std::size_t n) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (Capacity - (head - tail_cache_) < n) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+        }
+        const std::size_t room = Capacity - (head - tail_cache_);
+        if (n > room) n = room;
+        for (std::size_t i = 0; i < n; ++i) buf_[(head + i) & mask_] = items[i];
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    bool push(const T& item) { return push(&item, 1) == 1; }
+
+    // -------- consumer --------
+    // Removes up to max items, oldest first; returns how many.
+    std::size_t pop(T* out, std::size_t max) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_cache_ - tail < max) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+        }
+        std::size_t n = head_cache_ - tail;
+        if (n > max) n = max;
+        for (std::size_t i = 0; i < n; ++i) out[i] = buf_[(tail + i) & mask_];
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Either side; only a snapshot while the other side is running.
+    std::size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::size_t mask_ = Capacity - 1;
+    static constexpr std::size_t line_ = 64;
+
+    // producer side
+    alignas(line_) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    // consumer side
+    alignas(line_) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+
+    alignas(line_) std::array<T, Capacity> buf_{};
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "GPSsample.hpp"
+#include "IMUsample.hpp"
+
+// Joins one device's IMU samples (about 100 Hz) with its GPS fixes (about
+// 1 Hz): every IMU sample comes out once, in time order, annotated with
+// the GPS state interpolated to its timestamp. IMU_ingest -j runs one per
+// connection (combinedSession.hpp).
+//
+// Clock: fixes carry the phone's t and the GPS subsystem's t_gps. A
+// weighted least-squares fit of t_gps - t against t, with exponential
+// forgetting, gives the offset and drift of the GPS clock, and every
+// fix is placed on the phone clock (the one IMU samples use) by mapping
+// its t_gps back through the fit. This removes the jitter of the fix
+// times. The mean delivery delay of fixes stays in the offset.
+//
+// Watermark: the newest IMU time seen, minus `lateness`. Samples up to it
+// are complete, since no earlier one can still arrive. A sample is
+// released once it is under the watermark and a fix at or after its time
+// is in, so it can be interpolated. It is also released once it is
+// `max_wait` older than the newest IMU time, or when the buffer is full.
+// In those cases it carries the last fix, dead-reckoned by speed and
+// course (interpolated = false). IMU samples older than the last one
+// released are late and dropped. Fixes older than all four kept are
+// dropped too. A late fix that is still in range is used for the
+// samples after it.
+//
+// Memory is fixed per device: a ring of `capacity` IMU samples and the
+// last four fixes. Each push and release is O(1), plus the shift when an
+// out-of-order sample is slotted in behind the later ones already
+// buffered.
+class streamJoin {
+public:
+    static constexpr int capacity = 256;   // buffered IMU samples, a power of two
+
+    struct options {
+        double lateness = 0.05;   // s; IMU reordering tolerated
+        double max_wait = 1.5;    // s; longest an IMU sample waits for the next fix
+        double forget = 0.995;    // per fix, of the clock fit's weights (~200 fixes)
+    };
+
+    // One IMU sample with the GPS state at its time
+    struct joined {
+        IMUsample imu;
+        double t_gps = 0;         // sample time on the GPS clock
+        bool has_fix = false;     // no fix yet: the fields below are 0
+        bool interpolated = false;
+        double lat = 0, lon = 0, alt = 0;
+        double hAcc = 0, vAcc = 0;
+        double speed = -1, course = -1;   // -1 when not valid, as sent
+    };
+
+    explicit streamJoin(const options& o) : opt_(o) {}
+
+    void imu(const IMUsample& s);
+    void gps(const GPSsample& g);
+    // Next sample ready to go out, if any. Drain after every push: a full
+    // buffer releases its oldest sample here.
+    bool next(joined& out);
+    // End of the streams: releases everything still buffered
+    void flush() { flushing_ = true; }
+
+    // Phone time to GPS time and back, through the clock fit (the identity
+    // until a fix with t_gps has come in)
+    double to_gps(double t) const { return t + intercept_ + drift_ * (t - t_ref_); }
+    double to_phone(double t_gps) const { return (t_gps - intercept_ + drift_ * t_ref_) / (1.0 + drift_); }
+    double offset() const { return offset_; }   // s, t_gps - t at the last fix
+    double drift() const { return drift_; }     // s/s
+    double watermark() const { return imu_max_ - opt_.lateness; }
+
+    std::uint64_t late_imu() const { return late_imu_; }
+    std::uint64_t late_gps() const { return late_gps_; }
+    std::size_t buffered() const { return n_; }
+
+private:
+    struct fix {
+        double t;   // on the phone clock
+        GPSsample g;
+    };
+
+    options opt_;
+
+    // IMU samples by time, oldest at head_
+    std::array<IMUsample, capacity> ring_;
+    unsigned head_ = 0, n_ = 0;
+    double imu_max_ = -1e300;   // newest IMU time seen
+    double released_ = -1e300;  // time of the last sample out
+    bool flushing_ = false;
+
+    // last fixes by time, oldest first
+    std::array<fix, 4> fixes_;
+    int nfix_ = 0;
+
+    // clock fit sums, x = t - t_ref, y = t_gps - t
+    bool fitted_ = false;
+    double t_ref_ = 0;
+    double sw_ = 0, sx_ = 0, sy_ = 0, sxx_ = 0, sxy_ = 0;
+    double intercept_ = 0, offset_ = 0, drift_ = 0;
+
+    std::uint64_t late_imu_ = 0, late_gps_ = 0;
+
+    IMUsample& at_(unsigned i) { return ring_[(head_ + i) & (capacity - 1)]; }
+    void fit_(double t, double t_gps);
+    void annotate_(double t, joined& out) const;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ingestServer.hpp"
+
+// UDP ingest: every source address is one stream with its own handler, as a
+// TCP connection is for ingestServer. A lost datagram is a lost sample
+// rather than a stall.
+//
+// Datagrams carry binary frames (wireFormat.hpp) or NDJSON lines. Frames
+// are ordered by their seq field: a frame that arrives early waits in a
+// window of `window` frames (or at most `max_delay`) for the ones before it,
+// missing frames are then given up as lost, and frames older than the
+// window are dropped as late. A frame far behind the window means the
+// sender restarted its sequence, and ordering starts over from it. NDJSON
+// lines have no sequence and go to the handler as they arrive.
+//
+// Datagrams are pulled in batches with recvmmsg on Linux (recvfrom
+// elsewhere). One thread; all per-source state is owned by it.
+class udpServer {
+public:
+    struct stats {
+        std::uint64_t datagrams = 0;
+        std::uint64_t frames = 0;          // frames delivered in order
+        std::uint64_t samples = 0;         // samples in those frames
+        std::uint64_t reordered = 0;       // delivered, but arrived early
+        std::uint64_t lost_frames = 0;     // never arrived within the window
+        std::uint64_t late_samples = 0;    // arrived after their turn, dropped
+        std::uint64_t dropped_samples = 0; // duplicates of a held frame
+        std::uint64_t bad = 0;             // truncated or unparsable datagrams
+    };
+
+    udpServer(int port, ingestServer::factory make, int window = 16,
+              std::chrono::milliseconds max_delay = std::chrono::milliseconds(50));
+    ~udpServer();
+
+    udpServer(const udpServer&) = delete;
+    udpServer& operator=(const udpServer&) = delete;
+
+    // Receive on this interface only (see listenAddress); before start()
+    void set_host(const std::string& host) { host_ = host; }
+    // Binds; false (after perror) on failure.
+    bool start();
+    // Receives until stop().
+    void run();
+    // Makes run() return. Safe from any thread or a signal handler.
+    void stop();
+
+    // Totals over all sources, updated as datagrams are handled
+    stats totals() const;
+    std::size_t sources() const { return sources_.size(); }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct slot {
+        bool full = false;
+        std::string bytes;  // header + payload
+    };
+
+    struct source {
+        std::unique_ptr<ingestServer::handler> h;
+        bool started = false;
+        std::uint32_t next = 0;      // seq delivered next
+        int pending = 0;             // full slots
+        clock::time_point waiting_since{};
+        clock::time_point last_seen{};
+        std::vector<slot> slots;     // by seq % window
+    };
+
+    int port_;
+    std::string host_;
+    ingestServer::factory make_;
+    int window_;
+    clock::duration max_delay_;
+    int fd_ = -1;
+    int wake_fd_ = -1;
+#ifndef __linux__
+    int wake_write_fd_ = -1;  // pipe in place of the eventfd
+#endif
+    unsigned long next_id_ = 0;
+    std::unordered_map<std::string, source> sources_;  // by raw sockaddr bytes
+
+    // written by the run() thread only
+    struct counters {
+        std::atomic<std::uint64_t> datagrams{0}, frames{0}, samples{0}, reordered{0},
+            lost_frames{0}, late_samples{0}, dropped_samples{0}, bad{0};
+    } count_;
+
+    void datagram_(source& s, const char* p, std::size_t n, clock::time_point now);
+    void frame_(source& s, const char* p, std::size_t n, const wire::header& h, clock::time_point now);
+    void deliver_(source& s, const std::string& bytes);
+    void drain_(source& s);
+    void skip_(source& s);
+    // Delivers every held frame, counting the gaps between them as lost
+    void flush_(source& s);
+    void expire_(clock::time_point now);
+};
@@ -1,12 +1,79 @@
+#pragma once
+
 #include <array>
 #include <cmath>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
+#include "sortNetwork.hpp"
+#include "waveletFilters.hpp"
 
+// Streaming wavelet denoiser: Haar DWT of the last Window samples, soft
+// thresholding of the detail bands, IDWT, then weighted overlap-add so every
+// Hop samples a block of Hop denoised samples comes out.
+//
+// The Haar transform is an in-place lifting scheme (predict, update, scale)
+// whose first level reads straight out of the input ring, so a hop does no
+// window copies at all.
+//
+// Haar is the default. set_wavelet() switches an instance to one of the
+// Daubechies / Symlet / Coiflet filter banks in waveletFilters.hpp, which
+// are smoother on slow motion but cost roughly L/2 times more per level.
+//
+//   Window  samples per transform, power of two
+//   Levels  decomposition depth, Window >> Levels must stay >= 1
+//   Hop     samples between transforms (= samples emitted per denoise())
+//   T       float or double
+template <int Window = 64, int Levels = 3, int Hop = 8, typename T = double>
 class denoiser {
+    static_assert(std::is_floating_point<T>::value, "denoiser sample type must be float or double");
+    static_assert(Window >= 2 && (Window & (Window - 1)) == 0, "Window must be a power of two");
+    static_assert(Levels >= 1 && (Window >> Levels) >= 1, "Levels too deep for Window");
+    static_assert(Hop >= 1 && Hop <= Window, "Hop must be in [1, Window]");
+
 public:
-    static constexpr int windowSize = 64;
-    static constexpr int levels     = 3;
-    static constexpr int hop        = 8;
+    using value_type = T;
+
+    static constexpr int windowSize = Window;
+    static constexpr int levels     = Levels;
+    static constexpr int hop        = Hop;
+
+    // In-place lifting leaves the subbands interleaved: D_l sits at
+    // detail_offset(l) + k * detail_stride(l), A_L at multiples of 2^L.
+    static constexpr int detail_offset(int level) { return 1 << (level - 1); }
+    static constexpr int detail_stride(int level) { return 1 << level; }
+    static constexpr int detail_length(int level) { return Window >> level; }
+
+    // Lifting normalization, precomputed (sqrt2 is the correctly rounded value)
+    static constexpr T sqrt2     = T(1.4142135623730951);
+    static constexpr T inv_sqrt2 = T(0.70710678118654752);
+
+    // Lifting steps; batchDenoiser spells out the same operations on vectors.
+    // Forward: (e, o) -> ((e + o) / sqrt2, (e - o) / sqrt2) up to rounding.
+    static void lift_pair(T e, T o, T& s, T& d) {
+        const T p = o - e;             // predict
+        const T u = e + T(0.5) * p;    // update
+        s = u * sqrt2;
+        d = p * -inv_sqrt2;
+    }
+    static void unlift_pair(T s, T d, T& e, T& o) {
+        const T u = s * inv_sqrt2;
+        const T p = d * -sqrt2;
+        e = u - T(0.5) * p;
+        o = p + e;
+    }
+
+    // Threshold scale per detail level, relative to the universal threshold.
+    // Coarser levels carry more signal, so they are shrunk less.
+    static constexpr T level_scale(int level) {
+        return level == 1 ? T(1.0) : level == 2 ? T(0.6) : T(0.2);
+    }
+
+    // Noise sigma from the D1 band, MAD / 0.6745. Both give the same value:
+    //   select   std::nth_element for each median
+    //   network  bitonic sort of D1, then a bitonic merge of the deviations
+    //            (branch free, several times faster on 32 coefficients)
+    enum class sigma_estimator { select, network };
 
     denoiser();  // will init window weights
 
@@ -16,42 +83,405 @@ public:
     // Returns true when it emitted hop samples into out_* buffers.
     bool denoise();
 
+    // Forget every pushed sample and all pending output, as after a gap in
+    // the input: the next window starts with the next push.
+    void reset();
+
+    void set_wavelet(wavelets::family f, wavelets::boundary b = wavelets::boundary::periodic) {
+        family_ = f;
+        boundary_ = b;
+    }
+    wavelets::family wavelet() const { return family_; }
+    wavelets::boundary boundary_mode() const { return boundary_; }
+
+    void set_sigma_estimator(sigma_estimator e) { sigma_ = e; }
+    sigma_estimator sigma_method() const { return sigma_; }
+
     // Access last emitted hop samples
-    const std::array<double, hop>& out_x() const { return out_x_; }
-    const std::array<double, hop>& out_y() const { return out_y_; }
-    const std::array<double, hop>& out_z() const { return out_z_; }
+    // out_t()[k]: push time of the input sample that out_x/y/z()[k] is the
+    // denoised value of (windowSize - k pushes before the latest)
+    const std::array<double, hop>& out_t() const { return out_t_; }
+    const std::array<T, hop>& out_x() const { return out_x_; }
+    const std::array<T, hop>& out_y() const { return out_y_; }
+    const std::array<T, hop>& out_z() const { return out_z_; }
 
 private:
+    using window_t = std::array<T, windowSize>;
+
     // -------- input ring buffers --------
-    std::array<double, windowSize> t_{}, ax_{}, ay_{}, az_{};
+    std::array<double, windowSize> t_{};
+    window_t ax_{}, ay_{}, az_{};
     int idx = 0;         // points to the oldest sample position
     int count = 0;       // number of samples received (cap at windowSize)
     int hop_counter = 0; // counts samples since last denoise
     bool full = false;
 
     // -------- WOLA state (Part 1) --------
-    std::array<double, windowSize> win_{};       // Hann or rectangular weights
-    std::array<double, windowSize> ola_x_acc_{}, ola_x_wsum_{};
-    std::array<double, windowSize> ola_y_acc_{}, ola_y_wsum_{};
-    std::array<double, windowSize> ola_z_acc_{}, ola_z_wsum_{};
+    // Accumulators are rings too: slot ola_head_ is the oldest (next emitted)
+    // sample, so advancing by hop is a head move instead of a shift.
+    window_t win_{};       // Hann or rectangular weights
+    window_t ola_x_acc_{}, ola_x_wsum_{};
+    window_t ola_y_acc_{}, ola_y_wsum_{};
+    window_t ola_z_acc_{}, ola_z_wsum_{};
+    int ola_head_ = 0;
+
+    sigma_estimator sigma_ = sigma_estimator::select;
+
+    // -------- filter-bank wavelets --------
+    wavelets::family family_ = wavelets::family::haar;
+    wavelets::boundary boundary_ = wavelets::boundary::periodic;
+    // Bound on samples per band: symmetric extension adds up to L/2 per level
+    static constexpr int max_band_ = windowSize + wavelets::max_taps;
 
     // emitted hop samples each denoise call
-    std::array<double, hop> out_x_{}, out_y_{}, out_z_{};
+    std::array<T, hop> out_x_{}, out_y_{}, out_z_{};
+    std::array<double, hop> out_t_{};
 
     // -------- wavelet core --------
-    void haar_dwt(std::array<double, windowSize>& x, int levels);
-    void haar_idwt(std::array<double, windowSize>& x, int levels);
+    // haar_dwt reads the ring (oldest sample at idx) and writes x
+    void haar_dwt(const window_t& ring, window_t& x) const;
+    void haar_idwt(window_t& x) const;
+    // Copy anything indexed like the input ring out in window order
+    void linearize_(const window_t& ring, window_t& x) const;
 
-    double median(std::array<double, windowSize> v, std::size_t n);
-    double mad_sigma_from_detail(const std::array<double, windowSize>& coeffs, int start, int length);
-    void soft_threshold_range(std::array<double, windowSize>& coeffs, int start, int length, double T);
+    static T median(T* v, std::size_t n);
+    T mad_sigma_from_detail(const T* coeffs, int start, int stride, int length) const;
+    T mad_sigma_network_(const T* coeffs, int start, int stride) const;
+    T noise_sigma_(const T* coeffs, int start, int stride, int length) const;
+    void soft_threshold_range(T* coeffs, int start, int stride, int length, T thr) const;
 
     // -------- helpers (Part 3) --------
-    static void shift_left_hop_(std::array<double, windowSize>& acc,
-                                std::array<double, windowSize>& wsum);
-    void add_block_wola_(std::array<double, windowSize>& acc,
-                         std::array<double, windowSize>& wsum,
-                         const std::array<double, windowSize>& block);
+    void add_block_wola_(window_t& acc, window_t& wsum, const window_t& block) const;
+    T emit_wola_(window_t& acc, window_t& wsum, int slot) const;
 
-    void denoise_axis_(std::array<double, windowSize>& w);
+    void denoise_axis_(window_t& w) const;
+    void haar_denoise_(window_t& wx, window_t& wy, window_t& wz);
+    // Whole pipeline for a non-Haar family, ring in, denoised window out
+    void filter_denoise_axis_(const window_t& ring, window_t& w) const;
+
+    // f(integral_constant<int, 0>) ... f(integral_constant<int, N - 1>), fully unrolled
+    template <int N, typename F>
+    static void unroll_(F&& f) { unroll_impl_(f, std::make_integer_sequence<int, N>{}); }
+    template <typename F, int... I>
+    static void unroll_impl_(F& f, std::integer_sequence<int, I...>) {
+        (f(std::integral_constant<int, I>{}), ...);
+    }
 };
+
+template <int Window, int Levels, int Hop, typename T>
+denoiser<Window, Levels, Hop, T>::denoiser() {
+    constexpr double pi = 3.1415926;
+    for (int n = 0; n < windowSize; ++n) {
+        win_[n] = static_cast<T>(0.5 - 0.5 * std::cos(2.0 * pi * n / (windowSize - 1)));
+    }
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::add_block_wola_(window_t& acc, window_t& wsum,
+                                                      const window_t& block) const
+{
+    // block[n] lands in ring slot ola_head_ + n: walk the two contiguous spans
+    const int first = windowSize - ola_head_;
+    for (int n = 0; n < first; ++n) {
+        const T w = win_[n];
+        acc[ola_head_ + n]  += block[n] * w;
+        wsum[ola_head_ + n] += w;
+    }
+    for (int n = first; n < windowSize; ++n) {
+        const T w = win_[n];
+        acc[n - first]  += block[n] * w;
+        wsum[n - first] += w;
+    }
+}
+
+template <int Window, int Levels, int Hop, typename T>
+T denoiser<Window, Levels, Hop, T>::emit_wola_(window_t& acc, window_t& wsum, int slot) const
+{
+    // normalize, then clear the slot: it becomes the zeroed tail of the next window
+    const T out = (wsum[slot] > T(1e-12)) ? (acc[slot] / wsum[slot]) : T(0);
+    acc[slot]  = T(0);
+    wsum[slot] = T(0);
+    return out;
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::push(double t, double ax, double ay, double az)
+{
+    // overwrite oldest slot, then move idx forward
+    t_[idx]  = t;
+    ax_[idx] = static_cast<T>(ax);
+    ay_[idx] = static_cast<T>(ay);
+    az_[idx] = static_cast<T>(az);
+
+    idx = (idx + 1) % windowSize;
+
+    if (!full) {
+        count++;
+        if (count >= windowSize) full = true;
+    }
+
+    hop_counter++;
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::reset()
+{
+    idx = 0;
+    count = 0;
+    hop_counter = 0;
+    full = false;
+    for (window_t* a : {&ola_x_acc_, &ola_x_wsum_, &ola_y_acc_, &ola_y_wsum_, &ola_z_acc_, &ola_z_wsum_}) {
+        a->fill(T(0));
+    }
+    ola_head_ = 0;
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::denoise_axis_(window_t& w) const
+{
+    T sigma = noise_sigma_(w.data(), detail_offset(1), detail_stride(1), detail_length(1));
+    if (sigma > T(0)) {
+        const T N = static_cast<T>(windowSize);
+        const T thr = sigma * std::sqrt(T(2) * std::log(N));
+
+        // D1 gets the full threshold, deeper levels a fraction of it
+        unroll_<levels>([&](auto i) {
+            constexpr int level = decltype(i)::value + 1;
+            soft_threshold_range(w.data(), detail_offset(level), detail_stride(level),
+                                 detail_length(level), level_scale(level) * thr);
+        });
+    }
+
+    haar_idwt(w);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::haar_denoise_(window_t& wx, window_t& wy, window_t& wz)
+{
+    // 1) Forward transform, straight from the rings
+    haar_dwt(ax_, wx);
+    haar_dwt(ay_, wy);
+    haar_dwt(az_, wz);
+
+    // 2) Threshold, inverse in place
+    denoise_axis_(wx);
+    denoise_axis_(wy);
+    denoise_axis_(wz);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::filter_denoise_axis_(const window_t& ring, window_t& w) const
+{
+    linearize_(ring, w);
+
+    wavelets::with_taps(family_, [&](auto taps) {
+        using Taps = decltype(taps);
+        constexpr int L = Taps::length;
+
+        // Detail bands packed back to back, approximations ping-pong
+        std::array<T, levels * max_band_> details;
+        std::array<T, max_band_> approx[2];
+        int start[levels], len[levels], n_in[levels];
+
+        const T* src = w.data();
+        int n = windowSize;
+        int pos = 0;
+        for (int l = 0; l < levels; ++l) {
+            T* a = approx[l % 2].data();
+            n_in[l]  = n;
+            len[l]   = wavelets::coeff_count(n, L, boundary_);
+            start[l] = pos;
+            wavelets::analysis_step<Taps, max_band_>(src, n, boundary_, a, details.data() + pos);
+            pos += len[l];
+            src = a;
+            n = len[l];
+        }
+
+        const T sigma = noise_sigma_(details.data(), start[0], 1, len[0]);
+        if (sigma > T(0)) {
+            const T thr = sigma * std::sqrt(T(2) * std::log(static_cast<T>(windowSize)));
+            for (int l = 0; l < levels; ++l) {
+                soft_threshold_range(details.data(), start[l], 1, len[l], level_scale(l + 1) * thr);
+            }
+        }
+
+        for (int l = levels - 1; l >= 0; --l) {
+            T* out = (l == 0) ? w.data() : approx[(l + 1) % 2].data();
+            wavelets::synthesis_step<Taps, max_band_>(src, details.data() + start[l], n_in[l],
+                                                      boundary_, out);
+            src = out;
+        }
+    });
+}
+
+template <int Window, int Levels, int Hop, typename T>
+bool denoiser<Window, Levels, Hop, T>::denoise()
+{
+    if (!full) return false;
+    if (hop_counter < hop) return false;
+    hop_counter = 0;
+
+    window_t wx, wy, wz;
+    if (family_ != wavelets::family::haar) {
+        // 1-2) Filter-bank transform, threshold, inverse
+        filter_denoise_axis_(ax_, wx);
+        filter_denoise_axis_(ay_, wy);
+        filter_denoise_axis_(az_, wz);
+    } else {
+        haar_denoise_(wx, wy, wz);
+    }
+
+    // 3-4) WOLA: add current denoised block (weighted) at the ring head
+    add_block_wola_(ola_x_acc_, ola_x_wsum_, wx);
+    add_block_wola_(ola_y_acc_, ola_y_wsum_, wy);
+    add_block_wola_(ola_z_acc_, ola_z_wsum_, wz);
+
+    // 5) Emit hop samples (normalized) and advance the accumulators by hop
+    for (int k = 0; k < hop; ++k) {
+        const int slot = (ola_head_ + k) % windowSize;
+        out_x_[k] = emit_wola_(ola_x_acc_, ola_x_wsum_, slot);
+        out_y_[k] = emit_wola_(ola_y_acc_, ola_y_wsum_, slot);
+        out_z_[k] = emit_wola_(ola_z_acc_, ola_z_wsum_, slot);
+        out_t_[k] = t_[(idx + k) % windowSize];  // idx: oldest input
+    }
+    ola_head_ = (ola_head_ + hop) % windowSize;
+
+    return true;
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::haar_dwt(const window_t& ring, window_t& x) const
+{
+    // Level 1: the window is ring[idx, W) followed by ring[0, idx). Pairs are
+    // taken across both spans; if the first span is odd one pair straddles.
+    const T* a = ring.data() + idx;
+    const int na = windowSize - idx;
+    const T* b = ring.data();
+    const int nb = idx;
+
+    int out = 0, i = 0, k = 0;
+    for (; i + 1 < na; i += 2, out += 2) lift_pair(a[i], a[i + 1], x[out], x[out + 1]);
+    if (i < na) {
+        lift_pair(a[i], b[0], x[out], x[out + 1]);
+        out += 2;
+        k = 1;
+    }
+    for (; k + 1 < nb; k += 2, out += 2) lift_pair(b[k], b[k + 1], x[out], x[out + 1]);
+
+    // Levels 2..L: lift the previous approximations in place
+    unroll_<levels - 1>([&](auto i) {
+        constexpr int step = 2 << decltype(i)::value;
+        unroll_<windowSize / (2 * step)>([&](auto j) {
+            constexpr int e = 2 * step * decltype(j)::value;
+            lift_pair(x[e], x[e + step], x[e], x[e + step]);
+        });
+    });
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::haar_idwt(window_t& x) const
+{
+    // Undo the levels coarsest first, in place
+    unroll_<levels>([&](auto i) {
+        constexpr int step = 1 << (levels - 1 - decltype(i)::value);
+        unroll_<windowSize / (2 * step)>([&](auto j) {
+            constexpr int e = 2 * step * decltype(j)::value;
+            unlift_pair(x[e], x[e + step], x[e], x[e + step]);
+        });
+    });
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::linearize_(const window_t& ring, window_t& x) const
+{
+    // Window order: ring[idx, W) then ring[0, idx)
+    auto mid = std::copy(ring.begin() + idx, ring.end(), x.begin());
+    std::copy(ring.begin(), ring.begin() + idx, mid);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+T denoiser<Window, Levels, Hop, T>::median(T* v, std::size_t n) {
+    // Compute median of first n entries in v (reorders v)
+    if (n == 0) return T(0);
+    T* mid = v + n / 2;
+    std::nth_element(v, mid, v + n);
+    T m = *mid;
+    if (n % 2 == 0) {
+        T* mid2 = v + (n / 2 - 1);
+        std::nth_element(v, mid2, v + n);
+        m = T(0.5) * (m + *mid2);
+    }
+    return m;
+}
+
+template <int Window, int Levels, int Hop, typename T>
+T denoiser<Window, Levels, Hop, T>::mad_sigma_from_detail(const T* coeffs,
+                                                          int start, int stride, int len) const {
+    // sigma ≈ MAD / 0.6745
+    // MAD = median(|d - median(d)|)
+    std::array<T, max_band_> tmp;
+    if (len == 0) return T(0);
+
+    // calculate median
+    for (int i = 0; i < len; ++i) tmp[i] = coeffs[start + i * stride];
+    T med = median(tmp.data(), len);
+
+    // calculate diff median
+    for (int i = 0; i < len; ++i) tmp[i] = std::fabs(tmp[i] - med);
+    T mad = median(tmp.data(), len);
+
+    return mad / T(0.6745);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+T denoiser<Window, Levels, Hop, T>::mad_sigma_network_(const T* coeffs, int start, int stride) const {
+    constexpr int n = detail_length(1);
+    std::array<T, n> s, d;
+
+    for (int i = 0; i < n; ++i) s[i] = coeffs[start + i * stride];
+    sortnet::bitonic_sort<n>(s.data());
+    const T med = (n % 2 == 0) ? T(0.5) * (s[n / 2] + s[n / 2 - 1]) : s[n / 2];
+
+    // |s - med| falls towards the middle on the low half and rises on the
+    // high half, so low half reversed + high half reversed is bitonic.
+    if constexpr (n == 1) d[0] = std::fabs(s[0] - med);
+    for (int k = 0; k < n / 2; ++k) {
+        d[k]         = std::fabs(s[n / 2 - 1 - k] - med);
+        d[n / 2 + k] = std::fabs(s[n - 1 - k] - med);
+    }
+    sortnet::bitonic_merge<n>(d.data());
+    const T mad = (n % 2 == 0) ? T(0.5) * (d[n / 2] + d[n / 2 - 1]) : d[n / 2];
+
+    return mad / T(0.6745);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+T denoiser<Window, Levels, Hop, T>::noise_sigma_(const T* coeffs, int start, int stride, int len) const {
+    // The network is sized for the Haar / periodic D1 band
+    if (sigma_ == sigma_estimator::network && len == detail_length(1)) {
+        return mad_sigma_network_(coeffs, start, stride);
+    }
+    return mad_sigma_from_detail(coeffs, start, stride, len);
+}
+
+template <int Window, int Levels, int Hop, typename T>
+void denoiser<Window, Levels, Hop, T>::soft_threshold_range(T* coeffs,
+                                                            int start, int stride, int len,
+                                                            T thr) const {
+    // Soft threshold: sign(x)*max(|x|-T,0)
+    for (int k = 0; k < len; ++k) {
+        const int i = start + k * stride;
+        T x = coeffs[i];
+        T ax = std::fabs(x);
+        if (ax <= thr) {
+            coeffs[i] = T(0);
+        } else {
+            coeffs[i] = (x > 0 ? T(1) : T(-1)) * (ax - thr);
+        }
+    }
+}
+
+// The default configuration and its float twin are compiled once in
+// waveletDenoiser.cpp; other configurations instantiate where used.
+extern template class denoiser<>;
+extern template class denoiser<64, 3, 8, float>;
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <cmath>
+
+// Orthogonal wavelet filter banks for the denoiser: compile-time scaling
+// filter taps, periodic / symmetric boundary extension, and one analysis /
+// synthesis step of the fast wavelet transform.
+//
+// Taps are the scaling filter h[n] (PyWavelets rec_lo orientation), unit
+// norm, sum sqrt(2). The high-pass filter is g[n] = (-1)^n h[L-1-n].
+namespace wavelets {
+
+enum class family {
+    haar,
+    db2, db3, db4, db5, db6, db7, db8,
+    sym4, sym5, sym6, sym7, sym8,
+    coif1, coif2, coif3
+};
+
+// How a step sees samples outside [0, n):
+//   periodic   x[n + i] = x[i]; n/2 coefficients per band, n must be even
+//   symmetric  half-sample mirror x[-1 - i] = x[i]; (n + L - 1)/2 coefficients
+//              per band (PyWavelets "symmetric"), no wrap-around artifacts
+enum class boundary { periodic, symmetric };
+
+static constexpr int max_taps = 18;
+
+template <family F> struct taps;
+
+template <> struct taps<family::haar> {
+    static constexpr int length = 2;
+    static constexpr double lo[length] = { 0.70710678118654752, 0.70710678118654752 };
+};
+template <> struct taps<family::db2> {
+    static constexpr int length = 4;
+    static constexpr double lo[length] = {
+        0.48296291314453416, 0.8365163037378079, 0.2241438680420134, -0.1294095225512604
+    };
+};
+template <> struct taps<family::db3> {
+    static constexpr int length = 6;
+    static constexpr double lo[length] = {
+        0.33267055295008263, 0.8068915093110925, 0.45987750211849154, -0.13501102001025458,
+        -0.08544127388202657, 0.03522629188570957
+    };
+};
+template <> struct taps<family::db4> {
+    static constexpr int length = 8;
+    static constexpr double lo[length] = {
+        0.23037781330889645, 0.7148465705529156, 0.6308807679298588, -0.027983769416859823,
+        -0.18703481171909306, 0.030841381835560785, 0.0328830116668852, -0.010597401785069014
+    };
+};
+template <> struct taps<family::db5> {
+    static constexpr int length = 10;
+    static constexpr double lo[length] = {
+        0.16010239797419296, 0.6038292697971898, 0.7243085284377728, 0.1384281459013206,
+        -0.242294887066382, -0.03224486958463832, 0.07757149384004569, -0.006241490212798288,
+        -0.012580751999081985, 0.003335725285473769
+    };
+};
+template <> struct taps<family::db6> {
+    static constexpr int length = 12;
+    static constexpr double lo[length] = {
+        0.11154074335010941, 0.4946238903984528, 0.7511339080210954, 0.3152503517091981,
+        -0.22626469396543972, -0.12976686756726213, 0.09750160558732304, 0.027522865530305866,
+        -0.03158203931748603, 0.0005538422011614467, 0.004777257510945557,
+        -0.0010773010853084458
+    };
+};
+template <> struct taps<family::db7> {
+    static constexpr int length = 14;
+    static constexpr double lo[length] = {
+        0.0778520540850092, 0.3965393194819175, 0.7291320908462353, 0.4697822874051925,
+        -0.1439060039285655, -0.22403618499387432, 0.07130921926683058, 0.08061260915108252,
+        -0.038029936935014434, -0.016574541630666507, 0.01255099855609976,
+        0.0004295779729212618, -0.001801640704047421, 0.0003537137999745561
+    };
+};
+template <> struct taps<family::db8> {
+    static constexpr int length = 16;
+    static constexpr double lo[length] = {
+        0.054415842243103286, 0.3128715909142968, 0.675630736297287, 0.5853546836542106,
+        -0.015829105256342912, -0.2840155429615485, 0.0004724845739089841, 0.12874742662048053,
+        -0.017369301001805743, -0.0440882539307964, 0.013981027917398081, 0.008746094047406469,
+        -0.004870352993451686, -0.0003917403733770884, 0.00067544940645063,
+        -0.00011747678412473288
+    };
+};
+template <> struct taps<family::sym4> {
+    static constexpr int length = 8;
+    static constexpr double lo[length] = {
+        0.03222310060405152, -0.012603967262031585, -0.09921954357663548, 0.29785779560530284,
+        0.8037387518051313, 0.4976186676327779, -0.029635527645999683, -0.07576571478950142
+    };
+};
+template <> struct taps<family::sym5> {
+    static constexpr int length = 10;
+    static constexpr double lo[length] = {
+        0.02733306834499872, 0.029519490925706153, -0.03913424930231357, 0.19939753397685653,
+        0.7234076904040413, 0.6339789634567913, 0.016602105764509864, -0.1753280899080563,
+        -0.021101834024688744, 0.01953888273524993
+    };
+};
+template <> struct taps<family::sym6> {
+    static constexpr int length = 12;
+    static constexpr double lo[length] = {
+        0.015404109327044821, 0.0034907120842221696, -0.11799011114851991,
+        -0.04831174258569779, 0.49105594192797397, 0.7876411410286509, 0.3379294217281656,
+        -0.07263752278637678, -0.021060292512370928, 0.044724901770781374,
+        0.0017677118642539908, -0.007800708325032387
+    };
+};
+template <> struct taps<family::sym7> {
+    static constexpr int length = 14;
+    static constexpr double lo[length] = {
+        0.012015419283548802, 0.017213376300803204, -0.06490800354718736, -0.06413128980737519,
+        0.3602184609062759, 0.78192159329173, 0.4836109156822525, -0.05680447688967984,
+        -0.10101092086842159, 0.04474234946835407, 0.020464207577545832, -0.018126605131338687,
+        -0.0032832978474665315, 0.0022918339540538963
+    };
+};
+template <> struct taps<family::sym8> {
+    static constexpr int length = 16;
+    static constexpr double lo[length] = {
+        -0.0033824159510035846, -0.0005421323317949789, 0.031695087811528175,
+        0.007607487324978855, -0.14329423835120514, -0.061273359067621595, 0.4813596512592401,
+        0.7771857516996141, 0.364441894835998, -0.05194583810803253, -0.02721902991716026,
+        0.04913717967370551, 0.0038087520138745112, -0.014952258337069839,
+        -0.00030292051472412615, 0.0018899503327681028
+    };
+};
+template <> struct taps<family::coif1> {
+    static constexpr int length = 6;
+    static constexpr double lo[length] = {
+        -0.07273261951252645, 0.3378976624574817, 0.8525720202116004, 0.38486484686485783,
+        -0.07273261951252646, -0.01565572813579205
+    };
+};
+template <> struct taps<family::coif2> {
+    static constexpr int length = 12;
+    static constexpr double lo[length] = {
+        0.016387336463202586, -0.04146493678687006, -0.06737255472372233, 0.386110066822756,
+        0.8127236354494111, 0.41700518442324935, -0.07648859907828226, -0.05943441864643805,
+        0.023680171946850508, 0.005611434819370665, -0.0018232088709119808,
+        -0.0007205494455203812
+    };
+};
+template <> struct taps<family::coif3> {
+    static constexpr int length = 18;
+    static constexpr double lo[length] = {
+        -0.003793512864387104, 0.007782596425683532, 0.02345269614210898, -0.0657719112815328,
+        -0.06112339000303122, 0.40517690240927273, 0.7937772226261245, 0.4284834763771716,
+        -0.07179982161913255, -0.0823019271061596, 0.03455502757324956, 0.015880544863618864,
+        -0.00900797613670368, -0.0025745176881299204, 0.0011175187708256475,
+        0.0004662169598201742, -7.098330250653972e-05, -3.459977319701975e-05
+    };
+};
+
+// Calls fn(taps<f>{}), so kernels can be instantiated per filter length
+// and still be chosen at run time.
+template <typename Fn>
+void with_taps(family f, Fn&& fn) {
+    switch (f) {
+    case family::haar:  fn(taps<family::haar>{});  break;
+    case family::db2:   fn(taps<family::db2>{});   break;
+    case family::db3:   fn(taps<family::db3>{});   break;
+    case family::db4:   fn(taps<family::db4>{});   break;
+    case family::db5:   fn(taps<family::db5>{});   break;
+    case family::db6:   fn(taps<family::db6>{});   break;
+    case family::db7:   fn(taps<family::db7>{});   break;
+    case family::db8:   fn(taps<family::db8>{});   break;
+    case family::sym4:  fn(taps<family::sym4>{});  break;
+    case family::sym5:  fn(taps<family::sym5>{});  break;
+    case family::sym6:  fn(taps<family::sym6>{});  break;
+    case family::sym7:  fn(taps<family::sym7>{});  break;
+    case family::sym8:  fn(taps<family::sym8>{});  break;
+    case family::coif1: fn(taps<family::coif1>{}); break;
+    case family::coif2: fn(taps<family::coif2>{}); break;
+    case family::coif3: fn(taps<family::coif3>{}); break;
+    }
+}
+
+inline const char* name(family f) {
+    switch (f) {
+    case family::haar:  return "haar";
+    case family::db2:   return "db2";
+    case family::db3:   return "db3";
+    case family::db4:   return "db4";
+    case family::db5:   return "db5";
+    case family::db6:   return "db6";
+    case family::db7:   return "db7";
+    case family::db8:   return "db8";
+    case family::sym4:  return "sym4";
+    case family::sym5:  return "sym5";
+    case family::sym6:  return "sym6";
+    case family::sym7:  return "sym7";
+    case family::sym8:  return "sym8";
+    case family::coif1: return "coif1";
+    case family::coif2: return "coif2";
+    case family::coif3: return "coif3";
+    }
+    return "?";
+}
+
+inline int length(family f) {
+    int L = 0;
+    with_taps(f, [&](auto t) { L = decltype(t)::length; });
+    return L;
+}
+
+// Coefficients per band from one step over n samples with an L-tap filter
+constexpr int coeff_count(int n, int L, boundary b) {
+    return b == boundary::periodic ? n / 2 : (n + L - 1) / 2;
+}
+
+namespace detail {
+    // Analysis pair in the sample type, split into even / odd taps (polyphase)
+    template <typename Taps, typename T>
+    struct bank {
+        static constexpr int L = Taps::length;
+        static constexpr int h = L / 2;
+        T lo_even[h]{}, lo_odd[h]{}, hi_even[h]{}, hi_odd[h]{};
+
+        constexpr bank() {
+            for (int i = 0; i < h; ++i) {
+                lo_even[i] = static_cast<T>(Taps::lo[2 * i]);
+                lo_odd[i]  = static_cast<T>(Taps::lo[2 * i + 1]);
+                // g[j] = (-1)^j h[L-1-j]
+                hi_even[i] = static_cast<T>(Taps::lo[L - 1 - 2 * i]);
+                hi_odd[i]  = static_cast<T>(-Taps::lo[L - 2 - 2 * i]);
+            }
+        }
+    };
+
+    // Sample i of the extended signal
+    template <typename T>
+    inline T extended(const T* x, int n, int i, boundary b) {
+        int r = i % (b == boundary::periodic ? n : 2 * n);
+        if (r < 0) r += (b == boundary::periodic ? n : 2 * n);
+        return r < n ? x[r] : x[2 * n - 1 - r];
+    }
+
+    // Unrolls the tap loop so the inner loop over outputs stays contiguous
+    template <int I, int H, typename Fn>
+    inline void for_taps(Fn& fn) {
+        if constexpr (I < H) {
+            fn(I);
+            for_taps<I + 1, H>(fn);
+        }
+    }
+}
+
+// One analysis step: a[k] = sum_j h[j] x~[2(k0 + k) + j], d[k] likewise with g,
+// where k0 = 0 (periodic) or 1 - L/2 (symmetric). a and d get
+// coeff_count(n, L, b) values each. MaxN bounds n.
+template <typename Taps, int MaxN, typename T>
+void analysis_step(const T* x, int n, boundary b, T* a, T* d) {
+    static constexpr detail::bank<Taps, T> f{};
+    constexpr int L = Taps::length;
+    constexpr int h = L / 2;
+
+    const int count = coeff_count(n, L, b);
+    const int k0 = (b == boundary::periodic) ? 0 : 1 - h;
+
+    // even / odd phases of the extended input, so every tap below is a
+    // unit-stride multiply-add over all outputs
+    T even[MaxN / 2 + max_taps], odd[MaxN / 2 + max_taps];
+    for (int t = 0; t < count + h - 1; ++t) {
+        const int i = 2 * (k0 + t);
+        if (i >= 0 && i + 1 < n) {
+            even[t] = x[i];
+            odd[t]  = x[i + 1];
+        } else {
+            even[t] = detail::extended(x, n, i, b);
+            odd[t]  = detail::extended(x, n, i + 1, b);
+        }
+    }
+
+    for (int k = 0; k < count; ++k) { a[k] = T(0); d[k] = T(0); }
+    auto tap = [&](int i) {
+        const T le = f.lo_even[i], lo = f.lo_odd[i];
+        const T he = f.hi_even[i], ho = f.hi_odd[i];
+        const T* e = even + i;
+        const T* o = odd + i;
+        for (int k = 0; k < count; ++k) {
+            a[k] += le * e[k];
+            a[k] += lo * o[k];
+            d[k] += he * e[k];
+            d[k] += ho * o[k];
+        }
+    };
+    detail::for_taps<0, h>(tap);
+}
+
+// Inverse of analysis_step: rebuilds the n samples from a and d
+// (coeff_count(n, L, b) values each).
+template <typename Taps, int MaxN, typename T>
+void synthesis_step(const T* a, const T* d, int n, boundary b, T* x) {
+    static constexpr detail::bank<Taps, T> f{};
+    constexpr int L = Taps::length;
+    constexpr int h = L / 2;
+
+    const int count = coeff_count(n, L, b);
+    const int n_even = (n + 1) / 2;
+    const int n_odd = n / 2;
+
+    // x[2p] = sum_i h[2i] a[p - i] + g[2i] d[p - i], x[2p + 1] likewise with
+    // the odd taps. ae[t] holds a[t - (h - 1)], wrapped when periodic.
+    T ae[MaxN / 2 + max_taps], de[MaxN / 2 + max_taps];
+    for (int t = 0; t < n_even + h - 1; ++t) {
+        int k = t - (h - 1);
+        if (b == boundary::periodic) k = ((k % count) + count) % count;
+        else                         k = t;  // symmetric bands start at k0 = 1 - h
+        ae[t] = a[k];
+        de[t] = d[k];
+    }
+
+    T xe[MaxN / 2 + max_taps], xo[MaxN / 2 + max_taps];
+    for (int p = 0; p < n_even; ++p) { xe[p] = T(0); xo[p] = T(0); }
+    auto tap = [&](int i) {
+        const T le = f.lo_even[i], lo = f.lo_odd[i];
+        const T he = f.hi_even[i], ho = f.hi_odd[i];
+        const T* ap = ae + (h - 1 - i);
+        const T* dp = de + (h - 1 - i);
+        for (int p = 0; p < n_even; ++p) {
+            xe[p] += le * ap[p];
+            xe[p] += he * dp[p];
+            xo[p] += lo * ap[p];
+            xo[p] += ho * dp[p];
+        }
+    };
+    detail::for_taps<0, h>(tap);
+
+    for (int p = 0; p < n_odd; ++p) { x[2 * p] = xe[p]; x[2 * p + 1] = xo[p]; }
+    if (n_even > n_odd) x[n - 1] = xe[n_even - 1];
+}
+
+} // namespace wavelets
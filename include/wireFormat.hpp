@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "GPSsample.hpp"
+#include "IMUsample.hpp"
+
+class lineFramer;
+
+// Binary framing that can be sent on the same connections as NDJSON.
+//
+// A frame is a 24-byte little-endian header followed by `count` fixed-size
+// records. Its first byte (0xB1) can never start a JSON line, so receivers
+// tell the two apart message by message; a client may switch at any frame
+// or line boundary.
+//
+//   off size
+//     0   2  magic 0xB1 0x4D
+//     2   1  version (1)
+//     3   1  kind: 1 = IMU, 2 = GPS
+//     4   1  encoding, see below
+//     5   1  reserved (0)
+//     6   2  count   records in the frame
+//     8   4  seq     frame sequence number, chosen by the sender
+//    12   4  length  payload bytes (count * record size)
+//    16   8  base_t  float64; record times are offsets from it
+//
+// IMU records (t, quat[4], acc_g[3]):
+//   f64  64 B  t float64, quat and acc_g float64 (lossless)
+//   f32  32 B  dt uint32 microseconds, quat and acc_g float32
+//   q16  18 B  dt uint32 microseconds, quat int16 / 32767,
+//              acc_g int16 / 4096 (+-8 g, 0.24 mg steps)
+// GPS records (t, lat, lon, alt, hAcc, vAcc, speed, course, t_gps):
+//   f64  72 B  all float64
+//   f32  48 B  dt uint32 microseconds, lat/lon float64, alt, hAcc, vAcc,
+//              speed, course float32, t_gps float64
+namespace wire {
+
+constexpr std::uint8_t magic0 = 0xB1;
+constexpr std::uint8_t magic1 = 0x4D;
+constexpr std::uint8_t version = 1;
+constexpr std::size_t header_size = 24;
+// Frames must fit in a lineFramer line
+constexpr std::size_t max_frame = 64 * 1024;
+
+enum class kind : std::uint8_t { imu = 1, gps = 2 };
+enum class encoding : std::uint8_t { f64 = 0, f32 = 1, q16 = 2 };
+
+struct header {
+    kind k;
+    encoding enc;
+    std::uint16_t count;
+    std::uint32_t seq;
+    std::uint32_t length;
+    double base_t;
+};
+
+// Record size for kind/encoding, 0 if the pair is not defined
+std::size_t record_size(kind k, encoding enc);
+
+// Most records one frame can carry
+inline std::size_t max_records(kind k, encoding enc) {
+    const std::size_t r = record_size(k, enc);
+    return r ? (max_frame - header_size) / r : 0;
+}
+
+// -------- encoding --------
+// Append one frame with samples [0, n) to out. n must be at most
+// max_records(); returns false for an undefined kind/encoding pair.
+bool encode(const IMUsample* s, std::size_t n, encoding enc, std::uint32_t seq, std::string& out);
+bool encode(const GPSsample* s, std::size_t n, encoding enc, std::uint32_t seq, std::string& out);
+
+// -------- decoding --------
+// Reads a header from at least header_size bytes; false if the magic,
+// version, kind/encoding or length are not valid.
+bool read_header(const char* p, header& h);
+
+// Replace out with the frame's records; false if the payload does not
+// match the header.
+bool decode(const header& h, std::string_view payload, std::vector<IMUsample>& out);
+bool decode(const header& h, std::string_view payload, std::vector<GPSsample>& out);
+
+// One message from a connection: an NDJSON line or a binary frame.
+struct message {
+    bool binary = false;
+    std::string_view line;     // !binary
+    header hdr{};              // binary
+    std::string_view payload;  // binary
+};
+
+// Next complete message buffered in f, whatever its framing. Views stay
+// valid until the next f.read_from(). A frame with a bad header is skipped
+// one byte at a time (counted in bad_frames) until the stream resyncs.
+bool next(lineFramer& f, message& m, std::size_t* bad_frames = nullptr);
+
+} // namespace wire
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+
+// Turns device-frame acceleration into world-frame linear acceleration:
+// rotates acc_g by the sample's orientation quaternion and subtracts
+// gravity, so the denoiser sees motion rather than how the phone is held.
+//
+// Quaternions are (w, x, y, z), rotating device coordinates into world
+// coordinates, and need not be normalized: the rotation is built from
+// q / |q|^2 (no square root). A zero quaternion counts as the identity.
+//
+// Samples are queued structure-of-arrays and transformed `lanes` at a time
+// with the same GCC vector rows as batchDenoiser. The owner runs the queue
+// whenever it fills and at the end of each read, so a sample waits at most
+// for the rest of its burst.
+//
+// Acceleration may come at other times than orientation (resampled grid
+// points): its orientation is then slerped between the two orientation
+// samples around it, out of the last four.
+class worldFrame {
+public:
+    static constexpr int lanes = 8;    // one AVX-512 register, two AVX2
+    static constexpr int batch = 64;   // queued samples, a multiple of lanes
+
+    struct quat {
+        double w, x, y, z;
+    };
+
+    struct options {
+        // What the accelerometer reads at rest, in world coordinates (g)
+        double gravity[3] = {0.0, 0.0, 1.0};
+    };
+
+    explicit worldFrame(const options& o);
+
+    // Orientation at time t; times must increase (a repeat replaces)
+    void orient(double t, const quat& q);
+    // Queues device-frame acceleration at time t. False when the queue is
+    // full: run() it first.
+    bool add(double t, double x, double y, double z);
+    bool full() const { return n_ == batch; }
+
+    // Transforms the queue in place and returns its length; results stay
+    // readable until clear()
+    int run();
+    void clear() { n_ = 0; }
+    double t(int i) const { return t_[i]; }
+    double x(int i) const { return ax_[i]; }
+    double y(int i) const { return ay_[i]; }
+    double z(int i) const { return az_[i]; }
+
+    // Shortest-arc spherical interpolation, u in [0, 1]; a and b need not
+    // be normalized, the result is.
+    static quat slerp(const quat& a, const quat& b, double u);
+
+    // The transform itself, on n samples in place
+    static void transform(const double* qw, const double* qx, const double* qy, const double* qz,
+                          double* ax, double* ay, double* az, int n, const double* gravity);
+
+private:
+    options opt_;
+
+    // orientation track, oldest first
+    struct stamped {
+        double t;
+        quat q;
+    };
+    std::array<stamped, 4> track_{};
+    int tracked_ = 0;
+
+    // queue, structure of arrays
+    alignas(64) double qw_[batch], qx_[batch], qy_[batch], qz_[batch];
+    alignas(64) double ax_[batch], ay_[batch], az_[batch];
+    double t_[batch];
+    int n_ = 0;
+
+    quat at_(double t) const;
+};
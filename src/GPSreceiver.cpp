@@ -9,9 +9,11 @@
 #include <unistd.h>
 #include <nlohmann/json.hpp>
 #include "GPSreceiver.hpp"
+#include "latency.hpp"
+#include "lineFramer.hpp"
 
 namespace GPS{
-    bool parse_GPS(const std::string& line, GPSsample& out){
+    bool parse_GPS(std::string_view line, GPSsample& out){
         using nlohmann::json;
 
         json j;
@@ -39,18 +41,67 @@ namespace GPS{
         }
     }
 
-    void process(int connfd){
+    void session::on_line(std::string_view line){
+        if (line.empty()) return;
+        stats_.add(metrics::counter::lines);
 
-        std::string data(MAX, '\0');
-        std::string accum;
-        accum.reserve(8 * MAX);
+        GPSsample sample;
+        const latency::tick t0 = latency::now();
+        if (!parse_GPS(line, sample)) {
+            stats_.add(metrics::counter::parse_errors);
+            return;
+        }
+        latency::record(latency::stage::parse, t0);
+        on_sample_(sample);
+    }
+
+    void session::on_frame(const wire::header& h, std::string_view payload){
+        stats_.add(metrics::counter::frames);
+        const latency::tick t0 = latency::now();
+        if (!wire::decode(h, payload, frame_)) {
+            stats_.add(metrics::counter::parse_errors);
+            return;
+        }
+        latency::record(latency::stage::parse, t0);
+        for (const auto& sample : frame_) on_sample_(sample);
+    }
+
+    bool session::record(const std::string& path){
+        auto rec = std::make_unique<sessionRecorder>();
+        if (!rec->open(path)) return false;
+        rec_ = std::move(rec);
+        return true;
+    }
+
+    void session::on_sample_(const GPSsample& sample){
+        stats_.add(metrics::counter::samples);
+        out_.gps(sample);
+        if (rec_) rec_->gps(sample);
+    }
 
-        bool printed_debug_line = false;
+    void process(int connfd, std::size_t read_size, const char* record_path,
+                 asyncWriter* out, sinkFormat format){
+
+        // whatever stdio already holds comes first
+        std::fflush(stdout);
+        std::unique_ptr<asyncWriter> own;
+        if (!out) {
+            own = std::make_unique<asyncWriter>(STDOUT_FILENO);
+            out = own.get();
+        }
+        formatSink sink(out, format);
+
+        lineFramer framer(read_size);
+        session s(sink);
+        if (record_path && !s.record(record_path)) return;
 
         while (true) {
 
-            ssize_t byteCount = ::read(connfd, &data[0], data.size());
+            ssize_t byteCount = framer.read_from(connfd);
+            latency::mark_arrival();
             if (byteCount == 0) {
+                sink.flush();
+                out->flush();
                 std::cout << "Client disconnected.\n";
                 break;
             } else if (byteCount < 0) {
@@ -58,27 +109,18 @@ namespace GPS{
                 break;
             }
 
-            accum.append(data.data(), static_cast<size_t>(byteCount));
-
-            // Extract complete lines (newline-delimited JSON)
-            while (true) {
-                size_t pos = accum.find('\n');
-                if (pos == std::string::npos) break;
-
-                std::string line = accum.substr(0, pos);
-                accum.erase(0, pos + 1);
-
-                if (!line.empty() && line.back() == '\r') line.pop_back();
-                if (line.empty()) continue;
-
-                GPSsample sample;
-                if (!parse_GPS(line, sample)) {
-
-                    continue;
-                }
-                std::cout << sample;
+            s.on_read(static_cast<std::size_t>(byteCount));
 
+            // Extract complete messages (NDJSON lines or binary frames)
+            wire::message m;
+            latency::tick t0 = latency::now();
+            while (wire::next(framer, m)) {
+                latency::record(latency::stage::frame, t0);
+                if (m.binary) s.on_frame(m.hdr, m.payload);
+                else s.on_line(m.line);
+                t0 = latency::now();
             }
+            sink.flush();
         }
     }
-}
\ No newline at end of file
+}
@@ -37,6 +37,16 @@ void GPSsample::setTGPS(double tGPS){
     t_gps = tGPS;
 }   
 
+double GPSsample::getTime() const { return timestamp; }
+double GPSsample::getLatitude() const { return latitude; }
+double GPSsample::getLongitude() const { return longitude; }
+double GPSsample::getAltitude() const { return altitude; }
+double GPSsample::getHAcc() const { return hacc; }
+double GPSsample::getVAcc() const { return vacc; }
+double GPSsample::getSpeed() const { return speed; }
+double GPSsample::getCourse() const { return course; }
+double GPSsample::getTGPS() const { return t_gps; }
+
 std::ostream& operator<<(std::ostream& os, const GPSsample& sample){
     os << "GPS data: ";
     os << "t: " << sample.timestamp << "\n";
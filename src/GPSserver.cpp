@@ -8,10 +8,38 @@
 #include <sys/types.h> 
 #include <unistd.h>
 #include <nlohmann/json.hpp>
+#include <csignal>
 #include "GPSreceiver.hpp"
+#include "serverDriver.hpp"
 
-int main() 
+// GPS_server                  serve one client, then exit
+// GPS_server -m [n] [-r] [-c] [-q]   any number of clients over TCP
+// GPS_server -u [-q]                 any number of UDP senders
+// Port 7777 unless -p says otherwise; -m, -u, -p, -o, -d, -w, -M and -l
+// as described in serverDriver.hpp.
+int main(int argc, char** argv) 
 { 
+    driver::options opt(PORT);
+    for (int i = 1; i < argc; ++i) {
+        driver::arg a = driver::parse(argc, argv, i, opt);
+        if (a == driver::arg::bad) return 1;
+        if (a == driver::arg::other) {
+            fprintf(stderr, "usage: GPS_server [-p [host:]port] [-o format] [-d] [-w path] [-l [s]] [-M port|path] [-m [threads] [-r] [-c] [-q] | -u [-q]]\n");
+            return 1;
+        }
+    }
+    if (!driver::check(opt)) return 1;
+
+    // All session output goes through one background writer
+    asyncWriter out(STDOUT_FILENO, std::size_t(4) << 20,
+                    opt.drop ? asyncWriter::policy::drop : asyncWriter::policy::block);
+    metrics::endpoint stats;  // stopped before `out` goes away
+    if (opt.metrics && !driver::serve_metrics(opt.metrics, out, stats)) return 1;
+    if (opt.udp || opt.many) {
+        return driver::serve(opt, driver::sessions<bufferedSession<GPS::session>>(
+            opt, opt.quiet ? nullptr : &out, [](bufferedSession<GPS::session>&) {}), out);
+    }
+
     int sockfd, connfd; 
     socklen_t len;
     struct sockaddr_in servaddr, cli; 
@@ -27,9 +55,7 @@ int main()
     bzero(&servaddr, sizeof(servaddr)); 
   
     // assign IP, PORT 
-    servaddr.sin_family = AF_INET; 
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY); 
-    servaddr.sin_port = htons(PORT); 
+    if (!opt.listen.resolve(servaddr)) exit(1);
   
     // Binding newly created socket to given IP and verification 
     if ((bind(sockfd, (SA*)&servaddr, sizeof(servaddr))) != 0) { 
@@ -57,7 +83,8 @@ int main()
     else
         printf("server accept the client...\n"); 
 
-    GPS::process(connfd); 
+    GPS::process(connfd, MAX, opt.record, &out, opt.format); 
+    driver::report(opt, out);
   
     // After chatting close the socket 
     close(sockfd); 
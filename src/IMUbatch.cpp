@@ -0,0 +1,302 @@
+// IMU_batch: offline denoise of recorded NDJSON sessions on all cores.
+//
+//   IMU_batch [-j threads] [-p precision] [-o out] session.ndjson [more.ndjson ...]
+//
+// Every input file is one session (one live connection). The denoised
+// samples are written one "x y z" line each, formatted like the live
+// receiver, to <input>.denoised (or -o, for a single input).
+//
+// Sessions are split into chunks of hop blocks that run independently. A
+// chunk starting at block m0 is fed from block m0 - preroll on, where
+// preroll = ceil(W / hop) - 1 is the number of earlier windows that still
+// overlap block m0. Its first preroll emissions are dropped; from then on
+// its ring, WOLA accumulators and emitted samples are exactly those of the
+// live denoiser at the same point.
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "IMUreceiver.hpp"
+#include "waveletDenoiser.hpp"
+
+namespace {
+
+using dn_t = denoiser<>;
+
+constexpr int preroll = (dn_t::windowSize + dn_t::hop - 1) / dn_t::hop - 1;
+
+// Input is consumed in rounds of this many bytes, so memory stays bounded
+// however large the recording is.
+constexpr std::size_t round_bytes = std::size_t(64) << 20;
+// Blocks per denoise chunk; large enough that the preroll is noise.
+constexpr long chunk_blocks = 4096;
+
+struct options {
+    int threads = 0;
+    int precision = 6;  // std::ostream default, as printed by IMU::process
+    std::string out;
+    std::vector<std::string> inputs;
+};
+
+struct imu_row {
+    double t, ax, ay, az;
+};
+
+// Runs f(0) ... f(n - 1) on `threads` workers pulling from a shared counter.
+template <typename F>
+void parallel_for(long n, int threads, F f)
+{
+    std::atomic<long> next{0};
+    auto worker = [&]() {
+        for (long i = next++; i < n; i = next++) f(i);
+    };
+    std::vector<std::thread> pool;
+    const int extra = static_cast<int>(std::min<long>(threads, n)) - 1;
+    for (int t = 0; t < extra; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+// Parses the complete lines in [begin, end) the way IMU::process does:
+// strip '\r', skip empty lines and lines that do not parse.
+void parse_lines(const char* begin, const char* end, std::vector<imu_row>& out)
+{
+    IMUsample sample;
+    while (begin < end) {
+        const char* nl = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        const char* stop = nl ? nl : end;
+        std::string_view line(begin, static_cast<std::size_t>(stop - begin));
+        begin = stop + 1;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+        if (!IMU::parse_one_quat_accg(line, sample)) continue;
+
+        const auto a = sample.getAccG();
+        out.push_back({sample.getTimestamp(), a[0], a[1], a[2]});
+    }
+}
+
+// Start of the line containing p (p itself if it starts a line)
+const char* line_start(const char* base, const char* p)
+{
+    while (p > base && p[-1] != '\n') --p;
+    return p;
+}
+
+class batch_session {
+public:
+    batch_session(int threads, int precision, int fd) : threads_(threads), precision_(precision), fd_(fd) {}
+
+    // Adds samples to the session and writes every block that is complete.
+    bool feed(std::vector<imu_row>&& more, bool last);
+
+private:
+    int threads_;
+    int precision_;
+    int fd_;
+    off_t written_ = 0;
+
+    // samples from index base_ on (earlier ones are no longer needed)
+    std::vector<imu_row> buf_;
+    long base_ = 0;
+    long next_block_ = 0;  // first block not emitted yet
+
+    std::string run_chunk_(long m0, long m1) const;
+};
+
+std::string batch_session::run_chunk_(long m0, long m1) const
+{
+    // Block m is emitted after sample m * hop + W - 1 has been pushed
+    const long first_block = std::max(0L, m0 - preroll);
+    const long s_begin = first_block * dn_t::hop;
+    const long s_end = (m1 - 1) * dn_t::hop + dn_t::windowSize;
+    long skip = m0 - first_block;
+
+    dn_t dn;
+    IMU::setup_denoiser(dn);
+
+    std::string out;
+    out.reserve(static_cast<std::size_t>(m1 - m0) * dn_t::hop * 3 * (precision_ + 8));
+    char line[128];
+    for (long s = s_begin; s < s_end; ++s) {
+        const imu_row& r = buf_[s - base_];
+        dn.push(r.t, r.ax, r.ay, r.az);
+        if (!dn.denoise()) continue;
+        if (skip > 0) { --skip; continue; }
+
+        const auto& ox = dn.out_x();
+        const auto& oy = dn.out_y();
+        const auto& oz = dn.out_z();
+        for (int k = 0; k < dn_t::hop; ++k) {
+            const int n = std::snprintf(line, sizeof(line), "%.*g %.*g %.*g\n",
+                                        precision_, ox[k], precision_, oy[k], precision_, oz[k]);
+            out.append(line, static_cast<std::size_t>(n));
+        }
+    }
+    return out;
+}
+
+bool batch_session::feed(std::vector<imu_row>&& more, bool last)
+{
+    if (buf_.empty()) buf_ = std::move(more);
+    else buf_.insert(buf_.end(), more.begin(), more.end());
+
+    // Blocks whose window is complete
+    const long have = base_ + static_cast<long>(buf_.size());
+    const long end_block = have >= dn_t::windowSize ? (have - dn_t::windowSize) / dn_t::hop + 1 : 0;
+
+    const long blocks = end_block - next_block_;
+    if (blocks > 0) {
+        const long n_chunks = (blocks + chunk_blocks - 1) / chunk_blocks;
+        std::vector<std::string> text(n_chunks);
+        parallel_for(n_chunks, threads_, [&](long c) {
+            const long m0 = next_block_ + c * chunk_blocks;
+            const long m1 = std::min(end_block, m0 + chunk_blocks);
+            text[c] = run_chunk_(m0, m1);
+        });
+
+        // Chunk offsets are a prefix sum; the writes themselves are independent
+        std::vector<off_t> at(n_chunks + 1, written_);
+        for (long c = 0; c < n_chunks; ++c) at[c + 1] = at[c] + static_cast<off_t>(text[c].size());
+        std::atomic<bool> ok{true};
+        parallel_for(n_chunks, threads_, [&](long c) {
+            const char* p = text[c].data();
+            std::size_t left = text[c].size();
+            off_t off = at[c];
+            while (left > 0) {
+                const ssize_t n = ::pwrite(fd_, p, left, off);
+                if (n < 0) { std::perror("pwrite"); ok = false; return; }
+                p += n; left -= static_cast<std::size_t>(n); off += n;
+            }
+        });
+        if (!ok) return false;
+        written_ = at[n_chunks];
+        next_block_ = end_block;
+    }
+
+    // Keep what the next chunk's preroll will read
+    if (!last) {
+        const long keep_from = std::max(base_, (next_block_ - preroll) * dn_t::hop);
+        buf_.erase(buf_.begin(), buf_.begin() + (keep_from - base_));
+        base_ = keep_from;
+    }
+    return true;
+}
+
+bool denoise_file(const std::string& in_path, const std::string& out_path, const options& opt)
+{
+    const int in = ::open(in_path.c_str(), O_RDONLY);
+    if (in < 0) { std::perror(in_path.c_str()); return false; }
+    struct stat st{};
+    if (::fstat(in, &st) != 0) { std::perror("fstat"); ::close(in); return false; }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+
+    const char* data = nullptr;
+    if (size > 0) {
+        void* m = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, in, 0);
+        if (m == MAP_FAILED) { std::perror("mmap"); ::close(in); return false; }
+        ::madvise(m, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(m);
+    }
+
+    const int out = ::open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        std::perror(out_path.c_str());
+        if (data) ::munmap(const_cast<char*>(data), size);
+        ::close(in);
+        return false;
+    }
+
+    batch_session sess(opt.threads, opt.precision, out);
+    bool ok = true;
+    std::size_t pos = 0;
+    while (ok && pos < size) {
+        // Round [pos, stop) ends on a line boundary (or at EOF)
+        std::size_t stop = std::min(size, pos + round_bytes);
+        if (stop < size) {
+            const char* ls = line_start(data + pos, data + stop);
+            if (ls > data + pos) stop = static_cast<std::size_t>(ls - data);
+        }
+
+        // Parse pieces in parallel, then concatenate in file order
+        const int pieces = opt.threads;
+        std::vector<const char*> cut(pieces + 1);
+        cut[0] = data + pos;
+        cut[pieces] = data + stop;
+        for (int i = 1; i < pieces; ++i) {
+            const char* guess = data + pos + (stop - pos) * i / pieces;
+            cut[i] = std::max(cut[i - 1], line_start(data + pos, guess));
+        }
+        std::vector<std::vector<imu_row>> parsed(pieces);
+        parallel_for(pieces, opt.threads, [&](long i) { parse_lines(cut[i], cut[i + 1], parsed[i]); });
+
+        std::vector<imu_row> samples;
+        std::size_t total = 0;
+        for (const auto& p : parsed) total += p.size();
+        samples.reserve(total);
+        for (const auto& p : parsed) samples.insert(samples.end(), p.begin(), p.end());
+
+        pos = stop;
+        ok = sess.feed(std::move(samples), pos >= size);
+    }
+
+    if (data) ::munmap(const_cast<char*>(data), size);
+    ::close(in);
+    if (::close(out) != 0) { std::perror("close"); ok = false; }
+    return ok;
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: IMU_batch [-j threads] [-p precision] [-o out] session.ndjson [...]\n"
+                 "  writes <input>.denoised, one \"x y z\" line per denoised sample\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "-j" || arg == "-p" || arg == "-o") && i + 1 < argc) {
+            const char* v = argv[++i];
+            if (arg == "-j") opt.threads = std::atoi(v);
+            else if (arg == "-p") opt.precision = std::atoi(v);
+            else opt.out = v;
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            opt.inputs.push_back(arg);
+        }
+    }
+    if (opt.inputs.empty() || (!opt.out.empty() && opt.inputs.size() != 1)) {
+        usage();
+        return 1;
+    }
+    if (opt.threads <= 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (const auto& in : opt.inputs) {
+        const std::string out = opt.out.empty() ? in + ".denoised" : opt.out;
+        if (!denoise_file(in, out, opt)) {
+            std::fprintf(stderr, "IMU_batch: failed on %s\n", in.c_str());
+            return 1;
+        }
+        std::printf("%s -> %s\n", in.c_str(), out.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// IMU_fuse: fused position and velocity (fusionEngine.hpp) from recorded
+// sessions (sessionFile.hpp).
+//
+//   IMU_fuse [-d n] [-a accel_noise] [-s speed_noise] device.rec [imu.rec,gps.rec ...]
+//
+// Every argument is one device: a session file holding both its denoised
+// IMU and GPS streams, or two files joined by a comma when IMU_server and
+// GPS_server recorded separately. The denoised stream should be world-frame
+// linear acceleration, i.e. recorded by IMU_server -g. The two streams are
+// merged by timestamp and fed to one filter per device.
+//
+// Output is CSV on stdout, one row per n-th IMU sample (-d, default 1)
+// once the device has its first fix:
+//
+//   device,t,east,north,up,v_east,v_north,v_up,lat,lon,alt
+//
+// with east/north/up in metres from the device's first fix. A summary per
+// device goes to stderr.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fusionEngine.hpp"
+#include "sessionFile.hpp"
+
+namespace {
+
+struct options {
+    long every = 1;
+    fusionFilter::options filter;
+    std::vector<std::string> devices;
+};
+
+// One device's inputs; imu and gps may be the same file
+struct source {
+    std::unique_ptr<sessionReader> imu, gps;
+};
+
+bool open_source(const std::string& arg, source& s)
+{
+    const std::size_t comma = arg.find(',');
+    s.imu = std::make_unique<sessionReader>();
+    if (!s.imu->open(arg.substr(0, comma))) return false;
+    if (comma == std::string::npos) return true;
+    s.gps = std::make_unique<sessionReader>();
+    return s.gps->open(arg.substr(comma + 1));
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: IMU_fuse [-d n] [-a accel_noise] [-s speed_noise]"
+                 " device.rec [imu.rec,gps.rec ...]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.size() != 2 || arg[0] != '-') {
+            opt.devices.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) { usage(); return 1; }
+        const char* v = argv[++i];
+        switch (arg[1]) {
+        case 'd': opt.every = std::atol(v); break;
+        case 'a': opt.filter.accel_noise = std::atof(v); break;
+        case 's': opt.filter.speed_noise = std::atof(v); break;
+        default: usage(); return 1;
+        }
+    }
+    if (opt.devices.empty() || opt.every < 1 || !(opt.filter.accel_noise > 0) ||
+        !(opt.filter.speed_noise > 0)) {
+        usage();
+        return 1;
+    }
+
+    fusionEngine engine(opt.filter);
+    std::printf("device,t,east,north,up,v_east,v_north,v_up,lat,lon,alt\n");
+
+    for (std::size_t d = 0; d < opt.devices.size(); ++d) {
+        source src;
+        if (!open_source(opt.devices[d], src)) return 1;
+        const sessionReader& ir = *src.imu;
+        const sessionReader& gr = src.gps ? *src.gps : *src.imu;
+        const std::uint64_t ni = ir.rows(rec::stream::denoised);
+        const std::uint64_t ng = gr.rows(rec::stream::gps);
+        if (ni == 0) {
+            std::fprintf(stderr, "%s: no denoised samples (record with IMU_server -g -w)\n",
+                         opt.devices[d].c_str());
+        }
+        if (ng == 0) std::fprintf(stderr, "%s: no GPS samples\n", opt.devices[d].c_str());
+
+        fusionFilter& f = engine.device(d);
+        const auto t0 = std::chrono::steady_clock::now();
+        std::uint64_t i = 0, j = 0, predicted = 0;
+        while (i < ni || j < ng) {
+            // fixes first on equal timestamps
+            if (j < ng && (i == ni || gr.time(rec::stream::gps, j) <= ir.time(rec::stream::denoised, i))) {
+                f.correct(gr.gps(j++));
+                continue;
+            }
+            f.predict(ir.value(rec::stream::denoised, i, 0), ir.value(rec::stream::denoised, i, 1),
+                      ir.value(rec::stream::denoised, i, 2), ir.value(rec::stream::denoised, i, 3));
+            ++i;
+            if (!f.ready() || predicted++ % opt.every != 0) continue;
+
+            const fusionFilter::state& s = f.current();
+            double lat, lon, alt;
+            f.geodetic(lat, lon, alt);
+            std::printf("%zu,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.8f,%.8f,%.3f\n", d, s.t, s.p[0], s.p[1],
+                        s.p[2], s.v[0], s.v[1], s.v[2], lat, lon, alt);
+        }
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::fprintf(stderr, "%s: %llu IMU samples, %llu fixes used, %llu rejected, %.3f s\n",
+                     opt.devices[d].c_str(), static_cast<unsigned long long>(ni),
+                     static_cast<unsigned long long>(f.fixes()), static_cast<unsigned long long>(f.rejected()),
+                     secs);
+        engine.remove(d);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// IMU_ingest: IMU and GPS from the same phones on one port, where
+// IMU_server and GPS_server need a port (and a connection) each.
+//
+// Each connection may carry either stream or both, as NDJSON lines or
+// binary frames; messages are routed by type (combinedSession.hpp) to that
+// connection's IMU denoise pipeline or its GPS session. The output is
+// IMU_server's and GPS_server's records, interleaved per burst; csv and
+// binary tag each record with its stream.
+//
+// IMU_ingest [-p [host:]port] [-m [threads] [-r] [-c] | -u] [-q] [-O where] [-j]
+//            [-o format] [-d] [-w path] [-s rate[:cubic]] [-g] [-l [s]] [-M port|path]
+// Port 8888 unless -p says otherwise. Always serves any number of clients,
+// over TCP on one epoll thread unless -m says more, or over UDP with -u;
+// notices go to stderr, as stdout carries the records. -m, -u, -p, -o, -d,
+// -w, -M and -l as described in serverDriver.hpp; -s and -g as for
+// IMU_server.
+// -O [host:]port|path
+//     let consumers attach to the output: each client of this TCP socket
+//     (host 127.0.0.1 if left out) or Unix socket gets every record from
+//     the moment it connects. -q takes the output off stdout only.
+// -j
+//     also join each connection's IMU samples with its fixes (streamJoin.hpp):
+//     every IMU sample gets a record with the GPS position at its time,
+//     interpolated between fixes placed on the phone clock by the clock fit
+// -w path
+//     record connection n, both streams, to the session file path.<n>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include "asyncWriter.hpp"
+#include "combinedSession.hpp"
+#include "outputFanout.hpp"
+#include "serverDriver.hpp"
+
+namespace {
+    struct options : driver::options {
+        options() : driver::options(8888) {}  // IMU_server's port
+        const char* consumers = nullptr;  // -O where: output to attached consumers
+        bool join = false;      // -j: joined IMU/GPS records
+        IMU::pipeline stages;   // -s rate[:cubic], -g: ahead of the denoiser
+    };
+
+    void usage()
+    {
+        fprintf(stderr,
+                "usage: IMU_ingest [-p [host:]port] [-m [threads] [-r] [-c] | -u] [-q] [-O where] [-j]"
+                " [-o format] [-d] [-w path] [-s rate[:cubic]] [-g] [-l [s]] [-M port|path]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opt;
+    opt.notices = stderr;
+    for (int i = 1; i < argc; ++i) {
+        driver::arg a = driver::parse(argc, argv, i, opt);
+        if (a == driver::arg::other) a = driver::parse(argc, argv, i, opt.stages);
+        if (a == driver::arg::other && strcmp(argv[i], "-O") == 0 && i + 1 < argc) {
+            opt.consumers = argv[++i];
+            a = driver::arg::taken;
+        } else if (a == driver::arg::other && strcmp(argv[i], "-j") == 0) {
+            opt.join = true;
+            a = driver::arg::taken;
+        }
+        if (a == driver::arg::bad) return 1;
+        if (a == driver::arg::other) {
+            usage();
+            return 1;
+        }
+    }
+    if (!driver::check(opt)) return 1;
+
+    // Consumers get the records through the writer's tap, so they outlive it
+    outputFanout fan;
+    if (opt.consumers) {
+        if (!fan.start(opt.consumers)) return 1;
+        fprintf(stderr, "consumers on %s\n", opt.consumers);
+    }
+
+    // All session output goes through one background writer
+    asyncWriter out(opt.quiet ? -1 : STDOUT_FILENO, std::size_t(4) << 20,
+                    opt.drop ? asyncWriter::policy::drop : asyncWriter::policy::block);
+    if (opt.consumers) out.set_tap(fan.tap());
+    asyncWriter* sink = opt.quiet && !opt.consumers ? nullptr : &out;
+
+    metrics::endpoint stats;  // stopped before `out` goes away
+    if (opt.metrics) {
+        metrics::expose("ingest_consumers", "Consumers attached with -O.",
+                        metrics::kind::gauge, [&fan] { return double(fan.consumers()); });
+        metrics::expose("ingest_consumers_slow_total", "Consumers disconnected for falling behind.",
+                        metrics::kind::counter, [&fan] { return double(fan.disconnected_slow()); });
+        if (!driver::serve_metrics(opt.metrics, out, stats)) return 1;
+    }
+
+    const options& o = opt;
+    return driver::serve(opt, driver::sessions<combinedSession>(opt, sink, [&o](combinedSession& h) {
+        h.imu().configure(o.stages);
+        if (o.join) h.join(streamJoin::options());
+    }), out);
+}
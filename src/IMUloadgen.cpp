@@ -0,0 +1,274 @@
+// IMU_loadgen: many synthetic phones streaming to an IMU server, to measure
+// how ingest scales with server threads.
+//
+//   IMU_loadgen [-h host] [-p port] [-c connections] [-t threads] [-r hz] [-d seconds]
+//               [-b f64|f32|q16]
+//
+// Every connection sends the phone's NDJSON lines, or with -b the same
+// samples as binary frames (wireFormat.hpp), one frame per send. With -r 0 (the default)
+// each connection sends as fast as the server takes the data, so the rate
+// reported is the server's throughput; with -r hz each connection is paced
+// at hz samples per second like a real phone.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "IMUreceiver.hpp"
+#include "wireFormat.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+    std::string host = "127.0.0.1";
+    int port = PORT;
+    int connections = 100;
+    int threads = 1;
+    double rate = 0;  // samples per second per connection, 0 = unpaced
+    int seconds = 10;
+    bool binary = false;
+    wire::encoding enc = wire::encoding::f64;
+};
+
+// One recorded-looking session every phone replays from its own offset:
+// gravity on z, a slow sway and sensor noise, 100 Hz timestamps.
+struct script {
+    std::string text;
+    std::vector<std::size_t> line_at;  // start of each line, plus text.size()
+    std::vector<IMUsample> samples;    // the same lines, parsed
+
+    explicit script(int lines) {
+        std::mt19937 rng(1234);
+        std::normal_distribution<double> noise(0.0, 0.02);
+        char buf[256];
+        for (int i = 0; i < lines; ++i) {
+            const double t = i * 0.01;
+            const double sway = 0.1 * std::sin(2 * M_PI * 0.5 * t);
+            const int n = std::snprintf(buf, sizeof(buf),
+                "{\"t\": %.2f, \"quat\": [1, 0, 0, 0], \"acc_g\": [%.17g, %.17g, %.17g]}\n",
+                t, sway + noise(rng), noise(rng), 1.0 + noise(rng));
+            line_at.push_back(text.size());
+            text.append(buf, static_cast<std::size_t>(n));
+            samples.emplace_back();
+            IMU::parse_one_quat_accg(std::string_view(buf, static_cast<std::size_t>(n) - 1), samples.back());
+        }
+        line_at.push_back(text.size());
+    }
+
+    int lines() const { return static_cast<int>(line_at.size()) - 1; }
+};
+
+struct phone {
+    int fd = -1;
+    int next = 0;       // next script line
+    long sent = 0;      // lines sent so far
+    std::uint32_t seq = 0;  // next frame number
+};
+
+std::atomic<long> total_lines{0};
+std::atomic<long> total_bytes{0};
+std::atomic<bool> running{true};
+
+bool send_all(int fd, const char* p, std::size_t n)
+{
+    while (n > 0) {
+        const ssize_t k = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (k < 0) {
+            // the send timeout only bounds the wait for the end of the run
+            if ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) &&
+                running.load(std::memory_order_relaxed)) continue;
+            return !running.load(std::memory_order_relaxed);
+        }
+        p += k;
+        n -= static_cast<std::size_t>(k);
+    }
+    return true;
+}
+
+// Sends lines [next, next + count) of the script, wrapping at its end.
+bool send_lines(phone& ph, const script& sc, const options& opt, int count)
+{
+    thread_local std::string frame;
+    while (count > 0) {
+        int m = std::min(count, sc.lines() - ph.next);
+        const char* data;
+        std::size_t size;
+        if (opt.binary) {
+            m = std::min<int>(m, static_cast<int>(wire::max_records(wire::kind::imu, opt.enc)));
+            frame.clear();
+            wire::encode(&sc.samples[ph.next], m, opt.enc, ph.seq++, frame);
+            data = frame.data();
+            size = frame.size();
+        } else {
+            data = sc.text.data() + sc.line_at[ph.next];
+            size = sc.line_at[ph.next + m] - sc.line_at[ph.next];
+        }
+        if (!send_all(ph.fd, data, size)) return false;
+        ph.next = (ph.next + m) % sc.lines();
+        ph.sent += m;
+        count -= m;
+        total_lines.fetch_add(m, std::memory_order_relaxed);
+        total_bytes.fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+int connect_to(const options& opt)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    const std::string port = std::to_string(opt.port);
+    if (::getaddrinfo(opt.host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        std::fprintf(stderr, "cannot resolve %s\n", opt.host.c_str());
+        return -1;
+    }
+    const int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        std::perror("connect");
+        ::close(fd);
+        ::freeaddrinfo(res);
+        return -1;
+    }
+    ::freeaddrinfo(res);
+
+    // Never block past the end of the run on a server that stopped reading
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    // A small send buffer keeps what is counted as sent close to what the
+    // server has actually taken
+    const int sndbuf = 16 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    return fd;
+}
+
+void drive(std::vector<phone>& phones, const script& sc, const options& opt, clock_type::time_point t0)
+{
+    // Unpaced: a batch per phone in turn, blocking on backpressure
+    constexpr int batch = 64;
+
+    while (running.load(std::memory_order_relaxed)) {
+        bool idle = true;
+        const double elapsed = std::chrono::duration<double>(clock_type::now() - t0).count();
+        for (auto& ph : phones) {
+            if (ph.fd < 0) continue;
+            int count = batch;
+            if (opt.rate > 0) {
+                count = static_cast<int>(static_cast<long>(elapsed * opt.rate) - ph.sent);
+                if (count <= 0) continue;
+            }
+            idle = false;
+            if (!send_lines(ph, sc, opt, count)) {
+                std::perror("send");
+                ::close(ph.fd);
+                ph.fd = -1;
+            }
+        }
+        if (idle) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: IMU_loadgen [-h host] [-p port] [-c connections] [-t threads]"
+                 " [-r hz] [-d seconds] [-b f64|f32|q16]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const char* v = argv[++i];
+        switch (arg[1]) {
+        case 'h': opt.host = v; break;
+        case 'p': opt.port = std::atoi(v); break;
+        case 'c': opt.connections = std::atoi(v); break;
+        case 't': opt.threads = std::atoi(v); break;
+        case 'r': opt.rate = std::atof(v); break;
+        case 'd': opt.seconds = std::atoi(v); break;
+        case 'b':
+            opt.binary = true;
+            if (std::strcmp(v, "f64") == 0) opt.enc = wire::encoding::f64;
+            else if (std::strcmp(v, "f32") == 0) opt.enc = wire::encoding::f32;
+            else if (std::strcmp(v, "q16") == 0) opt.enc = wire::encoding::q16;
+            else { usage(); return 1; }
+            break;
+        default: usage(); return 1;
+        }
+    }
+    if (opt.connections < 1 || opt.threads < 1 || opt.seconds < 1) {
+        usage();
+        return 1;
+    }
+    opt.threads = std::min(opt.threads, opt.connections);
+
+    const script sc(6000);
+
+    // Phones are split over the threads up front; each thread owns its slice
+    std::vector<std::vector<phone>> slices(opt.threads);
+    std::mt19937 rng(42);
+    for (int c = 0; c < opt.connections; ++c) {
+        phone ph;
+        ph.fd = connect_to(opt);
+        if (ph.fd < 0) return 1;
+        ph.next = static_cast<int>(rng() % static_cast<unsigned>(sc.lines()));
+        slices[c % opt.threads].push_back(ph);
+    }
+    std::printf("%d connections to %s:%d on %d thread(s), ", opt.connections,
+                opt.host.c_str(), opt.port, opt.threads);
+    if (opt.rate > 0) std::printf("%g Hz each, ", opt.rate);
+    else std::printf("unpaced, ");
+    if (opt.binary) std::printf("binary frames\n");
+    else std::printf("NDJSON\n");
+
+    const auto t0 = clock_type::now();
+    std::vector<std::thread> pool;
+    for (auto& s : slices) pool.emplace_back([&s, &sc, &opt, t0] { drive(s, sc, opt, t0); });
+
+    long last_lines = 0;
+    for (int sec = 1; sec <= opt.seconds; ++sec) {
+        std::this_thread::sleep_until(t0 + std::chrono::seconds(sec));
+        const long lines = total_lines.load();
+        std::printf("%3ds  %10ld lines/s\n", sec, lines - last_lines);
+        std::fflush(stdout);
+        last_lines = lines;
+    }
+    running = false;
+    for (auto& th : pool) th.join();
+
+    const double elapsed = std::chrono::duration<double>(clock_type::now() - t0).count();
+    std::printf("total %ld lines, %.0f lines/s, %.1f MB/s\n", total_lines.load(),
+                total_lines.load() / elapsed, total_bytes.load() / elapsed / 1e6);
+
+    for (auto& s : slices) {
+        for (auto& ph : s) {
+            if (ph.fd >= 0) ::close(ph.fd);
+        }
+    }
+    return 0;
+}
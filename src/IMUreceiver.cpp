@@ -1,18 +1,133 @@
+#include <charconv>
 #include <iostream>
 #include <stdio.h>
 #include <netdb.h> 
 #include <netinet/in.h> 
 #include <stdlib.h> 
 #include <string.h> 
+#include <string_view>
 #include <sys/socket.h> 
 #include <sys/types.h> 
 #include <unistd.h>
 #include <nlohmann/json.hpp>
 #include "waveletDenoiser.hpp"
 #include "IMUreceiver.hpp"
+#include "latency.hpp"
+#include "lineFramer.hpp"
 
-namespace IMU{
-    bool parse_one_quat_accg(const std::string& line, IMUsample& out) {
+namespace {
+    // Single pass over one line in the shape the phone sends,
+    // {"t":..,"quat":[4],"acc_g":[3]} with keys in any order, plus the
+    // "type":"imu" tag of a combined stream (combinedSession.hpp). Anything
+    // else (extra keys, escapes, non-numbers, duplicates) returns false and
+    // the caller falls back to nlohmann, so accepted lines give exactly the
+    // values json::parse would.
+    struct line_scanner {
+        const char* p;
+        const char* end;
+
+        void skip_ws() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+        }
+
+        bool eat(char c) {
+            skip_ws();
+            if (p == end || *p != c) return false;
+            ++p;
+            return true;
+        }
+
+        // "key" without escapes
+        bool key(std::string_view& k) {
+            if (!eat('"')) return false;
+            const char* start = p;
+            while (p < end && *p != '"') {
+                if (*p == '\\' || static_cast<unsigned char>(*p) < 0x20) return false;
+                ++p;
+            }
+            if (p == end) return false;
+            k = std::string_view(start, static_cast<std::size_t>(p - start));
+            ++p;
+            return true;
+        }
+
+        // JSON number grammar, then from_chars (correctly rounded, like strtod)
+        bool number(double& v) {
+            skip_ws();
+            const char* start = p;
+            if (p < end && *p == '-') ++p;
+            if (p == end) return false;
+            if (*p == '0') {
+                ++p;
+            } else if (*p >= '1' && *p <= '9') {
+                while (p < end && *p >= '0' && *p <= '9') ++p;
+            } else {
+                return false;
+            }
+            bool integer = true;
+            if (p < end && *p == '.') {
+                integer = false;
+                ++p;
+                const char* digits = p;
+                while (p < end && *p >= '0' && *p <= '9') ++p;
+                if (p == digits) return false;
+            }
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                integer = false;
+                ++p;
+                if (p < end && (*p == '+' || *p == '-')) ++p;
+                const char* digits = p;
+                while (p < end && *p >= '0' && *p <= '9') ++p;
+                if (p == digits) return false;
+            }
+            const auto r = std::from_chars(start, p, v);
+            if (r.ec != std::errc() || r.ptr != p) return false;
+            // nlohmann reads "-0" as the integer 0
+            if (integer && v == 0.0) v = 0.0;
+            return true;
+        }
+
+        bool array(double* v, int n) {
+            if (!eat('[')) return false;
+            for (int i = 0; i < n; ++i) {
+                if (i > 0 && !eat(',')) return false;
+                if (!number(v[i])) return false;
+            }
+            return eat(']');
+        }
+    };
+
+    bool parse_fast(std::string_view line, double& t, double* q, double* a) {
+        line_scanner s{line.data(), line.data() + line.size()};
+        bool has_t = false, has_q = false, has_a = false, has_type = false;
+
+        if (!s.eat('{')) return false;
+        do {
+            std::string_view k;
+            if (!s.key(k) || !s.eat(':')) return false;
+            if (k == "t" && !has_t) {
+                if (!s.number(t)) return false;
+                has_t = true;
+            } else if (k == "quat" && !has_q) {
+                if (!s.array(q, 4)) return false;
+                has_q = true;
+            } else if (k == "acc_g" && !has_a) {
+                if (!s.array(a, 3)) return false;
+                has_a = true;
+            } else if (k == "type" && !has_type) {
+                std::string_view v;
+                if (!s.key(v) || v != "imu") return false;
+                has_type = true;
+            } else {
+                return false;
+            }
+        } while (s.eat(','));
+        if (!s.eat('}')) return false;
+        s.skip_ws();
+        return s.p == s.end && has_t && has_q && has_a;
+    }
+
+    bool parse_json(std::string_view line, double& t, double* q, double* a) {
         using nlohmann::json;
 
         json j;
@@ -29,69 +144,221 @@ namespace IMU{
             if (!qj.is_array() || qj.size() != 4) return false;
             if (!aj.is_array() || aj.size() != 3) return false;
 
-            double q[4], a[3];
             for (int i = 0; i < 4; ++i) q[i] = qj[i].get<double>();
             for (int i = 0; i < 3; ++i) a[i] = aj[i].get<double>();
-            out.setTimestamp(j["t"].get<double>());
-            out.setQuat(q);
-            out.setAccG(a);
+            t = j["t"].get<double>();
             return true;
         }catch(...){
             return false;
         }
     }
+}
+
+namespace IMU{
+    bool parse_one_quat_accg(std::string_view line, IMUsample& out) {
+        double t, q[4], a[3];
+        if (!parse_fast(line, t, q, a) && !parse_json(line, t, q, a)) {
+            return false;
+        }
+        out.setTimestamp(t);
+        out.setQuat(q);
+        out.setAccG(a);
+        return true;
+    }
+
+    void setup_denoiser(denoiser<>& dn)
+    {
+        dn.set_sigma_estimator(denoiser<>::sigma_estimator::network);
+    }
 
-    void process(int connfd)
+    session::session(sampleSink& out) : out_(out)
     {
-        std::string data(MAX, '\0');
-        std::string accum;
-        accum.reserve(8 * MAX);
+        setup_denoiser(dn_);
+    }
 
-        bool printed_debug_line = false;
-        denoiser dn;
+    void session::on_line(std::string_view line)
+    {
+        if (line.empty()) return;
+        stats_.add(metrics::counter::lines);
 
-        while (true) {
-            ssize_t byteCount = ::read(connfd, &data[0], data.size());
-            if (byteCount == 0) {
-                std::cout << "Client disconnected.\n";
-                break;
-            } else if (byteCount < 0) {
-                std::perror("read");
-                break;
+        IMUsample sample;
+        const latency::tick t0 = latency::now();
+        if (!parse_one_quat_accg(line, sample)) {
+            stats_.add(metrics::counter::parse_errors);
+            return;
+        }
+        latency::record(latency::stage::parse, t0);
+        on_sample_(sample);
+    }
+
+    void session::on_frame(const wire::header& h, std::string_view payload)
+    {
+        stats_.add(metrics::counter::frames);
+        const latency::tick t0 = latency::now();
+        if (!wire::decode(h, payload, frame_)) {
+            stats_.add(metrics::counter::parse_errors);
+            return;
+        }
+        latency::record(latency::stage::parse, t0);
+        for (const auto& sample : frame_) on_sample_(sample);
+    }
+
+    void session::configure(const pipeline& p)
+    {
+        if (p.grid) grid_.emplace(*p.grid);
+        else grid_.reset();
+        world_ = p.world ? std::make_unique<worldFrame>(*p.world) : nullptr;
+    }
+
+    void session::flush()
+    {
+        if (world_) run_world_();
+    }
+
+    bool session::record(const std::string& path)
+    {
+        auto rec = std::make_unique<sessionRecorder>();
+        if (!rec->open(path)) return false;
+        rec_ = std::move(rec);
+        return true;
+    }
+
+    void session::on_sample_(const IMUsample& sample)
+    {
+        stats_.add(metrics::counter::samples);
+        out_.imu(sample);
+        if (rec_) rec_->imu(sample);
+        if (world_) {
+            const auto q = sample.getQuat();
+            world_->orient(sample.getTimestamp(), {q[0], q[1], q[2], q[3]});
+        }
+        const auto a = sample.getAccG();
+        if (grid_) {
+            const std::uint64_t gaps = grid_->gaps(), dropped = grid_->dropped();
+            grid_->push(sample.getTimestamp(), a[0], a[1], a[2],
+                        [this](double t, double x, double y, double z) { accel_(t, x, y, z); });
+            if (grid_->dropped() != dropped) stats_.add(metrics::counter::grid_dropped);
+            if (grid_->gaps() != gaps) {
+                stats_.add(metrics::counter::grid_gaps);
+                restart_denoiser_();
             }
+        } else {
+            accel_(sample.getTimestamp(), a[0], a[1], a[2]);
+        }
+    }
 
-            accum.append(data.data(), static_cast<size_t>(byteCount));
+    void session::accel_(double t, double x, double y, double z)
+    {
+        if (!world_) {
+            denoise_(t, x, y, z);
+            return;
+        }
+        world_->add(t, x, y, z);
+        if (world_->full()) run_world_();
+    }
 
-            // Extract complete lines (newline-delimited JSON)
-            while (true) {
-                size_t pos = accum.find('\n');
-                if (pos == std::string::npos) break;
+    void session::restart_denoiser_()
+    {
+        // the run before the gap goes through first; what is still in the
+        // window then never comes out
+        if (world_) run_world_();
+        dn_.reset();
+    }
 
-                std::string line = accum.substr(0, pos);
-                accum.erase(0, pos + 1);
+    void session::run_world_()
+    {
+        const int n = world_->run();
+        for (int i = 0; i < n; ++i) denoise_(world_->t(i), world_->x(i), world_->y(i), world_->z(i));
+        world_->clear();
+    }
 
-                if (!line.empty() && line.back() == '\r') line.pop_back();
-                if (line.empty()) continue;
+    void session::denoise_(double t, double x, double y, double z)
+    {
+        latency::tick t0 = latency::now();
+        dn_.push(t, x, y, z);
+        latency::record(latency::stage::push, t0);
+        if constexpr (latency::enabled) arrivals_[pushed_++ % arrivals_.size()] = latency::arrival;
 
-                IMUsample sample;
-                if (!parse_one_quat_accg(line, sample)) {
-                    continue;
-                }
-                std::cout << sample;
-                const auto a = sample.getAccG();
-                dn.push(sample.getTimestamp(), a[0], a[1], a[2]);
-
-                // Drain all available hop outputs (important on bursty reads)
-                while (dn.denoise()) {
-                    const auto& ox = dn.out_x();
-                    const auto& oy = dn.out_y();
-                    const auto& oz = dn.out_z();
-
-                    for (int k = 0; k < denoiser::hop; ++k) {
-                        std::cout << ox[k] << " " << oy[k] << " " << oz[k] << std::endl;
-                    }
+        // Drain all available hop outputs (important on bursty reads)
+        t0 = latency::now();
+        while (dn_.denoise()) {
+            latency::record(latency::stage::denoise, t0);
+            stats_.add(metrics::counter::hops);
+            stats_.add(metrics::counter::denoised, denoiser<>::hop);
+            const auto& ot = dn_.out_t();
+            const auto& ox = dn_.out_x();
+            const auto& oy = dn_.out_y();
+            const auto& oz = dn_.out_z();
+
+            t0 = latency::now();
+            for (int k = 0; k < denoiser<>::hop; ++k) {
+                out_.denoised(ot[k], ox[k], oy[k], oz[k]);
+            }
+            if (rec_) {
+                for (int k = 0; k < denoiser<>::hop; ++k) {
+                    rec_->denoised(ot[k], ox[k], oy[k], oz[k]);
                 }
             }
+            latency::record(latency::stage::emit, t0);
+            if constexpr (latency::enabled) record_end_to_end_();
+            t0 = latency::now();
+        }
+    }
+
+    void session::record_end_to_end_()
+    {
+        // Output k of a hop is input pushed_ - windowSize + k: the window
+        // delay is part of its latency.
+        constexpr std::uint64_t w = denoiser<>::windowSize;
+        if (pushed_ < w) return;
+        for (int k = 0; k < denoiser<>::hop; ++k) {
+            latency::record(latency::stage::end_to_end, arrivals_[(pushed_ - w + k) % w]);
+        }
+    }
+
+    void process(int connfd, std::size_t read_size, const char* record_path,
+                 asyncWriter* out, sinkFormat format, const pipeline& stages)
+    {
+        // whatever stdio already holds comes first
+        std::fflush(stdout);
+        std::unique_ptr<asyncWriter> own;
+        if (!out) {
+            own = std::make_unique<asyncWriter>(STDOUT_FILENO);
+            out = own.get();
+        }
+        formatSink sink(out, format);
+
+        lineFramer framer(read_size);
+        session s(sink);
+        s.configure(stages);
+        if (record_path && !s.record(record_path)) return;
+
+        while (true) {
+            ssize_t byteCount = framer.read_from(connfd);
+            latency::mark_arrival();
+            if (byteCount <= 0) {
+                // a reset connection still gets what the stages hold (-g)
+                if (byteCount < 0) std::perror("read");
+                s.flush();
+                sink.flush();
+                out->flush();
+                if (byteCount == 0) std::cout << "Client disconnected.\n";
+                break;
+            }
+
+            s.on_read(static_cast<std::size_t>(byteCount));
+
+            // Extract complete messages (NDJSON lines or binary frames)
+            wire::message m;
+            latency::tick t0 = latency::now();
+            while (wire::next(framer, m)) {
+                latency::record(latency::stage::frame, t0);
+                if (m.binary) s.on_frame(m.hdr, m.payload);
+                else s.on_line(m.line);
+                t0 = latency::now();
+            }
+            s.flush();
+            sink.flush();
         }
     }
-}
\ No newline at end of file
+}
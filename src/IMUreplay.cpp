@@ -0,0 +1,230 @@
+// IMU_replay: streams a recorded session file (sessionFile.hpp) back into
+// IMU_server and GPS_server, to reproduce a session or load the pipeline
+// with real traffic.
+//
+//   IMU_replay [-h host] [-p imu_port] [-g gps_port] [-s t] [-e t] [-x speed | -f]
+//              [-b f64|f32|q16] session.rec
+//
+// Raw IMU samples go to imu_port and GPS samples to gps_port (-g 0 skips
+// them), as binary frames over TCP, in timestamp order starting at the
+// first sample with t >= -s (found by binary search, so starting late in a
+// long file costs nothing) and stopping before -e. Samples are paced at
+// their recorded rate times -x, or sent as fast as the servers take them
+// with -f. Denoised samples in the file are not sent; the server
+// recomputes them.
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sessionFile.hpp"
+#include "wireFormat.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+    std::string host = "127.0.0.1";
+    int imu_port = 8888;   // IMU_server's PORT
+    int gps_port = 7777;   // GPS_server's PORT
+    double start = -std::numeric_limits<double>::infinity();
+    double end = std::numeric_limits<double>::infinity();
+    double speed = 1;      // 0 = as fast as possible
+    wire::encoding enc = wire::encoding::f64;
+    std::string path;
+};
+
+// Frames are cut at this much recorded time when paced, so a 1x replay
+// arrives in phone-sized pieces rather than one frame per sample.
+constexpr double frame_span = 0.02;
+
+int connect_to(const std::string& host, int port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    const std::string service = std::to_string(port);
+    if (::getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0 || !res) {
+        std::fprintf(stderr, "cannot resolve %s\n", host.c_str());
+        return -1;
+    }
+    int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        std::perror("connect");
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    return fd;
+}
+
+bool send_all(int fd, const char* p, std::size_t n)
+{
+    while (n > 0) {
+        const ssize_t k = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += k;
+        n -= static_cast<std::size_t>(k);
+    }
+    return true;
+}
+
+// One stream of the file on its way to one server
+template <typename Sample>
+struct feed {
+    int fd = -1;
+    std::uint64_t next = 0, end = 0;  // rows still to send
+    std::uint32_t seq = 0;
+    wire::kind k;
+    wire::encoding enc;
+    std::vector<Sample> batch;
+    std::string frame;
+    long sent = 0;
+
+    bool done() const { return fd < 0 || next >= end; }
+
+    // Sends the rows with t < until (at most one frame); false on error
+    template <typename Get>
+    bool send_until(const sessionReader& r, rec::stream s, double until, Get get) {
+        const std::size_t cap = wire::max_records(k, enc);
+        batch.clear();
+        while (next < end && batch.size() < cap && r.time(s, next) < until) batch.push_back(get(next++));
+        if (batch.empty()) return true;
+        frame.clear();
+        wire::encode(batch.data(), batch.size(), enc, seq++, frame);
+        sent += static_cast<long>(batch.size());
+        return send_all(fd, frame.data(), frame.size());
+    }
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: IMU_replay [-h host] [-p imu_port] [-g gps_port] [-s t] [-e t]"
+                 " [-x speed | -f] [-b f64|f32|q16] session.rec\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-f") {
+            opt.speed = 0;
+            continue;
+        }
+        if (arg.size() != 2 || arg[0] != '-') {
+            if (!opt.path.empty()) { usage(); return 1; }
+            opt.path = arg;
+            continue;
+        }
+        if (i + 1 >= argc) { usage(); return 1; }
+        const char* v = argv[++i];
+        switch (arg[1]) {
+        case 'h': opt.host = v; break;
+        case 'p': opt.imu_port = std::atoi(v); break;
+        case 'g': opt.gps_port = std::atoi(v); break;
+        case 's': opt.start = std::atof(v); break;
+        case 'e': opt.end = std::atof(v); break;
+        case 'x': opt.speed = std::atof(v); break;
+        case 'b':
+            if (std::strcmp(v, "f64") == 0) opt.enc = wire::encoding::f64;
+            else if (std::strcmp(v, "f32") == 0) opt.enc = wire::encoding::f32;
+            else if (std::strcmp(v, "q16") == 0) opt.enc = wire::encoding::q16;
+            else { usage(); return 1; }
+            break;
+        default: usage(); return 1;
+        }
+    }
+    if (opt.path.empty() || opt.speed < 0) {
+        usage();
+        return 1;
+    }
+
+    sessionReader r;
+    if (!r.open(opt.path)) return 1;
+
+    feed<IMUsample> imu;
+    imu.k = wire::kind::imu;
+    imu.enc = opt.enc;
+    imu.next = r.seek(rec::stream::imu, opt.start);
+    imu.end = r.seek(rec::stream::imu, opt.end);
+    feed<GPSsample> gps;
+    gps.k = wire::kind::gps;
+    // GPS has no q16 records
+    gps.enc = opt.enc == wire::encoding::q16 ? wire::encoding::f32 : opt.enc;
+    gps.next = r.seek(rec::stream::gps, opt.start);
+    gps.end = r.seek(rec::stream::gps, opt.end);
+
+    if (imu.next < imu.end && (imu.fd = connect_to(opt.host, opt.imu_port)) < 0) return 1;
+    if (opt.gps_port > 0 && gps.next < gps.end &&
+        (gps.fd = connect_to(opt.host, opt.gps_port)) < 0) return 1;
+    std::printf("%s: %llu IMU and %llu GPS samples to send, ", opt.path.c_str(),
+                static_cast<unsigned long long>(imu.fd >= 0 ? imu.end - imu.next : 0),
+                static_cast<unsigned long long>(gps.fd >= 0 ? gps.end - gps.next : 0));
+    if (opt.speed > 0) std::printf("%gx\n", opt.speed);
+    else std::printf("unpaced\n");
+
+    auto get_imu = [&r](std::uint64_t i) { return r.imu(i); };
+    auto get_gps = [&r](std::uint64_t i) { return r.gps(i); };
+    auto next_t = [&]() {
+        double t = std::numeric_limits<double>::infinity();
+        if (!imu.done()) t = std::min(t, r.time(rec::stream::imu, imu.next));
+        if (!gps.done()) t = std::min(t, r.time(rec::stream::gps, gps.next));
+        return t;
+    };
+
+    // Recorded time t goes out at wall time t0 + (t - t_first) / speed
+    const double t_first = next_t();
+    const auto t0 = clock_type::now();
+    while (!imu.done() || !gps.done()) {
+        double until = std::numeric_limits<double>::infinity();
+        if (opt.speed > 0) {
+            const double now = std::chrono::duration<double>(clock_type::now() - t0).count();
+            until = t_first + now * opt.speed;
+            const double t = next_t();
+            if (t >= until) {
+                // sleep to the next due sample, then send a frame's worth
+                std::this_thread::sleep_for(std::chrono::duration<double>((t - until) / opt.speed));
+                continue;
+            }
+            until = std::max(until, t + frame_span);
+        }
+
+        // The stream that is behind goes first, so the two stay in step
+        const bool imu_first = gps.done() ||
+            (!imu.done() && r.time(rec::stream::imu, imu.next) <= r.time(rec::stream::gps, gps.next));
+        const bool ok = imu_first ? imu.send_until(r, rec::stream::imu, until, get_imu)
+                                  : gps.send_until(r, rec::stream::gps, until, get_gps);
+        if (!ok) {
+            std::perror("send");
+            return 1;
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(clock_type::now() - t0).count();
+    std::printf("sent %ld IMU and %ld GPS samples in %.3f s (%.0f samples/s)\n", imu.sent, gps.sent,
+                elapsed, (imu.sent + gps.sent) / std::max(elapsed, 1e-9));
+
+    if (imu.fd >= 0) ::close(imu.fd);
+    if (gps.fd >= 0) ::close(gps.fd);
+    return 0;
+}
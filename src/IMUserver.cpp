@@ -8,10 +8,56 @@
 #include <sys/types.h> 
 #include <unistd.h>
 #include <nlohmann/json.hpp>
+#include <csignal>
 #include "IMUreceiver.hpp"
+#include "serverDriver.hpp"
 
-int main() 
+namespace {
+    // Per-stream options; the shared ones are parsed by serverDriver.hpp
+    struct options : driver::options {
+        options() : driver::options(PORT) {}
+        IMU::pipeline stages;   // -s rate[:cubic], -g: ahead of the denoiser
+    };
+}
+
+// IMU_server                  serve one client, then exit
+// IMU_server -m [n] [-r] [-c] [-q]   any number of clients over TCP
+// IMU_server -u [-q]                 any number of UDP senders
+// Port 8888 unless -p says otherwise; -m, -u, -p, -o, -d, -w, -M and -l
+// as described in serverDriver.hpp.
+// -s rate[:linear|:cubic]
+//     resample the acceleration onto a grid of `rate` Hz (resampler.hpp)
+//     before denoising, so jitter and dropped samples do not skew the
+//     transform; denoised output then carries grid times
+// -g
+//     denoise world-frame linear acceleration instead of acc_g: rotated by
+//     the sample's quaternion, gravity removed (worldFrame.hpp)
+int main(int argc, char** argv) 
 { 
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        driver::arg a = driver::parse(argc, argv, i, opt);
+        if (a == driver::arg::other) a = driver::parse(argc, argv, i, opt.stages);
+        if (a == driver::arg::bad) return 1;
+        if (a == driver::arg::other) {
+            fprintf(stderr, "usage: IMU_server [-p [host:]port] [-o format] [-d] [-w path] [-s rate[:cubic]] [-g] [-l [s]] [-M port|path] [-m [threads] [-r] [-c] [-q] | -u [-q]]\n");
+            return 1;
+        }
+    }
+    if (!driver::check(opt)) return 1;
+
+    // All session output goes through one background writer
+    asyncWriter out(STDOUT_FILENO, std::size_t(4) << 20,
+                    opt.drop ? asyncWriter::policy::drop : asyncWriter::policy::block);
+    metrics::endpoint stats;  // stopped before `out` goes away
+    if (opt.metrics && !driver::serve_metrics(opt.metrics, out, stats)) return 1;
+    if (opt.udp || opt.many) {
+        const IMU::pipeline& stages = opt.stages;
+        return driver::serve(opt, driver::sessions<bufferedSession<IMU::session>>(
+            opt, opt.quiet ? nullptr : &out,
+            [&stages](bufferedSession<IMU::session>& h) { h.session().configure(stages); }), out);
+    }
+
     int sockfd, connfd; 
     socklen_t len;
     struct sockaddr_in servaddr, cli; 
@@ -27,9 +73,7 @@ int main()
     bzero(&servaddr, sizeof(servaddr)); 
   
     // assign IP, PORT 
-    servaddr.sin_family = AF_INET; 
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY); 
-    servaddr.sin_port = htons(PORT); 
+    if (!opt.listen.resolve(servaddr)) exit(1);
   
     // Binding newly created socket to given IP and verification 
     if ((bind(sockfd, (SA*)&servaddr, sizeof(servaddr))) != 0) { 
@@ -57,7 +101,8 @@ int main()
     else
         printf("server accept the client...\n"); 
   
-    IMU::process(connfd); 
+    IMU::process(connfd, MAX, opt.record, &out, opt.format, opt.stages); 
+    driver::report(opt, out);
   
     // After chatting close the socket 
     close(sockfd); 
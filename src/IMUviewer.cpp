@@ -1,10 +1,13 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
-#include <mutex>
+#include <cstring>
 #include <string>
 #include <thread>
+#include <vector>
 
 // macOS sockets
 #include <sys/socket.h>
@@ -21,7 +24,13 @@
 #include "implot.h"
 
 #include "IMUreceiver.hpp"
+#include "historyStore.hpp"
+#include "ingestServer.hpp"
+#include "latency.hpp"
+#include "lineFramer.hpp"
+#include "spscQueue.hpp"
 #include "waveletDenoiser.hpp"
+#include "wireFormat.hpp"
 
 // ----------------------
 // Ring buffer (last 150)
@@ -51,16 +60,78 @@ struct Ring150 {
     }
 };
 
+// ----------------------
+// Receiver -> UI handoff
+// ----------------------
+struct AccSample {
+    float x, y, z;
+};
+
+// Lock-free: the receiver thread is the only producer, the UI loop the only
+// consumer. Samples the UI has not drained when a queue fills up are dropped
+// by the receiver (and counted) rather than blocking it.
+struct ImuQueues {
+    static constexpr std::size_t capacity = 4096;
+    spscQueue<AccSample, capacity> raw;
+    spscQueue<AccSample, capacity> denoised;
+    std::atomic<unsigned long> dropped{0};
+    // when the oldest batch not yet drained was published (IMU_LATENCY only)
+    std::atomic<latency::tick> published{0};
+
+    void publish(spscQueue<AccSample, capacity>& q, const AccSample* s, std::size_t n) {
+        const std::size_t sent = q.push(s, n);
+        if (sent < n) dropped.fetch_add(n - sent, std::memory_order_relaxed);
+        if constexpr (latency::enabled) {
+            latency::tick none = 0;
+            if (sent > 0) published.compare_exchange_strong(none, latency::now(), std::memory_order_relaxed);
+        }
+    }
+};
+
+// UI-side copies, touched only by the render loop
 struct ImuRawBuffers {
     Ring150 ax, ay, az;       // raw
     Ring150 ax_d, ay_d, az_d;  // denoised
-    std::mutex m;
+
+    // Long history (~2.9 h at 100 Hz) for the scrollable plot
+    historyStore hist[3]{historyStore(1 << 20), historyStore(1 << 20), historyStore(1 << 20)};
+    historyStore hist_d[3]{historyStore(1 << 20), historyStore(1 << 20), historyStore(1 << 20)};
+
+    // Moves everything queued so far into the rings.
+    void drain(ImuQueues& q) {
+        if constexpr (latency::enabled) {
+            const latency::tick t = q.published.exchange(0, std::memory_order_relaxed);
+            if (t != 0) latency::record(latency::stage::plot, t);
+        }
+        AccSample batch[256];
+        std::size_t n;
+        while ((n = q.raw.pop(batch, 256)) > 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                ax.push(batch[i].x);
+                ay.push(batch[i].y);
+                az.push(batch[i].z);
+                hist[0].push(batch[i].x);
+                hist[1].push(batch[i].y);
+                hist[2].push(batch[i].z);
+            }
+        }
+        while ((n = q.denoised.pop(batch, 256)) > 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                ax_d.push(batch[i].x);
+                ay_d.push(batch[i].y);
+                az_d.push(batch[i].z);
+                hist_d[0].push(batch[i].x);
+                hist_d[1].push(batch[i].y);
+                hist_d[2].push(batch[i].z);
+            }
+        }
+    }
 };
 
 // ----------------------
 // TCP receiver thread
 // ----------------------
-static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running) {
+static void tcp_receiver_thread(ImuQueues* q, std::atomic<bool>* running, listenAddress where) {
     int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0) {
         std::fprintf(stderr, "[viewer] socket() failed\n");
@@ -71,12 +142,14 @@ static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running)
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
     sockaddr_in servaddr{};
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(PORT);
+    if (!where.resolve(servaddr)) {
+        close(sockfd);
+        return;
+    }
 
     if (bind(sockfd, (SA*)&servaddr, sizeof(servaddr)) != 0) {
-        std::fprintf(stderr, "[viewer] bind() failed on port %d (is IMU_server running?)\n", PORT);
+        std::fprintf(stderr, "[viewer] bind() failed on %s (is IMU_server running? try -p)\n",
+                     where.str().c_str());
         close(sockfd);
         return;
     }
@@ -87,7 +160,7 @@ static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running)
         return;
     }
 
-    std::fprintf(stderr, "[viewer] listening on TCP port %d ...\n", PORT);
+    std::fprintf(stderr, "[viewer] listening on TCP %s ...\n", where.str().c_str());
 
     // Accept with select timeout so we can stop gracefully.
     int connfd = -1;
@@ -123,12 +196,14 @@ static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running)
 
     // Denoiser runs in the receiver thread to preserve sample order.
     // It outputs in hop-sized chunks; we push each output sample into ax_d/ay_d/az_d.
-    denoiser dn;
+    denoiser<> dn;
+    IMU::setup_denoiser(dn);
 
-    std::string accum;
-    accum.reserve(4096);
+    lineFramer framer(MAX);
 
-    char buf_read[MAX];
+    // Samples of one read, published to the UI in one go
+    std::vector<AccSample> raw_batch, denoised_batch;
+    std::vector<IMUsample> frame;
 
     // Read loop with select timeout so we can stop gracefully.
     while (running->load()) {
@@ -147,56 +222,68 @@ static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running)
         }
         if (ret == 0) continue; // timeout
 
-        ssize_t n = read(connfd, buf_read, sizeof(buf_read));
+        latency::tick t0 = latency::now();
+        ssize_t n = framer.read_from(connfd);
         if (n <= 0) {
             std::fprintf(stderr, "[viewer] connection closed\n");
             break;
         }
+        latency::record(latency::stage::read, t0);
 
-        accum.append(buf_read, buf_read + n);
-
-        // process complete lines
-        size_t pos;
-        while ((pos = accum.find('\n')) != std::string::npos) {
-            std::string line = accum.substr(0, pos);
-            accum.erase(0, pos + 1);
-
-            // Handle CRLF if present
-            if (!line.empty() && line.back() == '\r') line.pop_back();
-            if (line.empty()) continue;
-
-            IMUsample sample;
-            if (!IMU::parse_one_quat_accg(line, sample)) continue;
+        raw_batch.clear();
+        denoised_batch.clear();
 
+        auto feed = [&](const IMUsample& sample) {
             const auto a = sample.getAccG(); // accel only
 
             // Feed raw sample to denoiser (no locks).
+            latency::tick t = latency::now();
             dn.push(sample.getTimestamp(), a[0], a[1], a[2]);
+            latency::record(latency::stage::push, t);
 
-            // Push raw sample immediately.
-            {
-                std::lock_guard<std::mutex> lk(buf->m);
-                buf->ax.push(static_cast<float>(a[0]));
-                buf->ay.push(static_cast<float>(a[1]));
-                buf->az.push(static_cast<float>(a[2]));
-            }
+            raw_batch.push_back({static_cast<float>(a[0]), static_cast<float>(a[1]),
+                                 static_cast<float>(a[2])});
 
-            // Drain any available hop outputs and push to denoised buffers.
+            // Drain any available hop outputs into the denoised batch.
             // Note: denoiser::denoise() returns true when a new hop block is ready.
+            t = latency::now();
             while (dn.denoise()) {
+                latency::record(latency::stage::denoise, t);
                 const auto& ox = dn.out_x();
                 const auto& oy = dn.out_y();
                 const auto& oz = dn.out_z();
-                {
-                    std::lock_guard<std::mutex> lk(buf->m);
-                    for (int k = 0; k < denoiser::hop; ++k) {
-                        buf->ax_d.push(static_cast<float>(ox[k]));
-                        buf->ay_d.push(static_cast<float>(oy[k]));
-                        buf->az_d.push(static_cast<float>(oz[k]));
-                    }
+                for (int k = 0; k < denoiser<>::hop; ++k) {
+                    denoised_batch.push_back({static_cast<float>(ox[k]), static_cast<float>(oy[k]),
+                                              static_cast<float>(oz[k])});
                 }
+                t = latency::now();
             }
+        };
+
+        // process complete messages: NDJSON lines (CRLF already stripped)
+        // or binary frames
+        wire::message m;
+        for (t0 = latency::now(); wire::next(framer, m); t0 = latency::now()) {
+            latency::record(latency::stage::frame, t0);
+            const latency::tick tp = latency::now();
+            if (m.binary) {
+                if (!wire::decode(m.hdr, m.payload, frame)) continue;
+                latency::record(latency::stage::parse, tp);
+                for (const auto& sample : frame) feed(sample);
+                continue;
+            }
+            if (m.line.empty()) continue;
+
+            IMUsample sample;
+            if (!IMU::parse_one_quat_accg(m.line, sample)) continue;
+            latency::record(latency::stage::parse, tp);
+            feed(sample);
         }
+
+        t0 = latency::now();
+        q->publish(q->raw, raw_batch.data(), raw_batch.size());
+        q->publish(q->denoised, denoised_batch.data(), denoised_batch.size());
+        latency::record(latency::stage::emit, t0);
     }
 
     close(connfd);
@@ -204,7 +291,21 @@ static void tcp_receiver_thread(ImuRawBuffers* buf, std::atomic<bool>* running)
     std::fprintf(stderr, "[viewer] receiver thread exit\n");
 }
 
-int main() {
+// IMU_viewer [-p [host:]port]
+//     listen for one phone on port (default PORT) of the interface with
+//     IPv4 address host, or of all interfaces; a port other than
+//     IMU_server's lets both run at once
+int main(int argc, char** argv) {
+    listenAddress where{"", PORT};
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc && where.parse(argv[i + 1])) {
+            ++i;
+        } else {
+            std::fprintf(stderr, "usage: IMU_viewer [-p [host:]port]\n");
+            return 1;
+        }
+    }
+
     // ----------------------
     // GLFW + OpenGL init
     // ----------------------
@@ -219,7 +320,7 @@ int main() {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
-    GLFWwindow* window = glfwCreateWindow(900, 800, "IMU Viewer (Raw Accel)", nullptr, nullptr);
+    GLFWwindow* window = glfwCreateWindow(900, 1100, "IMU Viewer (Raw Accel)", nullptr, nullptr);
     if (!window) {
         std::fprintf(stderr, "Failed to create GLFW window\n");
         glfwTerminate();
@@ -243,9 +344,10 @@ int main() {
     // ----------------------
     // Data + receiver thread
     // ----------------------
+    ImuQueues queues;
     ImuRawBuffers raw;
     std::atomic<bool> running{true};
-    std::thread rx(tcp_receiver_thread, &raw, &running);
+    std::thread rx(tcp_receiver_thread, &queues, &running, where);
 
     // x-axis (0..149)
     static constexpr int N = Ring150::N;
@@ -258,6 +360,9 @@ int main() {
     int count = 0;
     int count_d = 0;
 
+    // history plot columns (reused every frame)
+    std::vector<double> hist_x, hist_lo, hist_hi, hist_y;
+
     // Y-axis range for acc_g units (adjust if needed)
     float y_max = 2.0f;
 
@@ -267,17 +372,15 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
-        // Snapshot buffers (lock briefly)
-        {
-            std::lock_guard<std::mutex> lk(raw.m);
-            count = raw.ax.snapshot(ax_s);
-            raw.ay.snapshot(ay_s);
-            raw.az.snapshot(az_s);
+        // Take what the receiver published since the last frame (never blocks)
+        raw.drain(queues);
+        count = raw.ax.snapshot(ax_s);
+        raw.ay.snapshot(ay_s);
+        raw.az.snapshot(az_s);
 
-            count_d = raw.ax_d.snapshot(axd_s);
-            raw.ay_d.snapshot(ayd_s);
-            raw.az_d.snapshot(azd_s);
-        }
+        count_d = raw.ax_d.snapshot(axd_s);
+        raw.ay_d.snapshot(ayd_s);
+        raw.az_d.snapshot(azd_s);
 
         // Window 1 plot
         ImGui_ImplOpenGL3_NewFrame();
@@ -297,8 +400,10 @@ int main() {
             | ImGuiWindowFlags_NoCollapse;
 
         ImGui::Begin("IMU Raw Accel", nullptr, flags);
-        ImGui::Text("Listening on TCP port %d (stop IMU_server if it uses the same port).", PORT);
-        ImGui::Text("Samples available: %d / %d", count, N);
+        ImGui::Text("Listening on TCP %s (IMU_server must use another port, see -p).",
+                    where.str().c_str());
+        ImGui::Text("Samples available: %d / %d (dropped: %lu)", count, N,
+                    queues.dropped.load(std::memory_order_relaxed));
 
         static bool show_denoised = true;
         ImGui::SliderFloat("Y_max", &y_max, 0.0f, 5.0f);
@@ -352,7 +457,7 @@ int main() {
                 float day_last = ayd_s[count_d - 1];
                 float daz_last = azd_s[count_d - 1];
                 ImGui::Separator();
-                ImGui::Text("DENOISED (hop=%d)", denoiser::hop);
+                ImGui::Text("DENOISED (hop=%d)", denoiser<>::hop);
                 ImGui::Text("ax: %.4f g", dax_last);
                 ImGui::Text("ay: %.4f g", day_last);
                 ImGui::Text("az: %.4f g", daz_last);
@@ -362,6 +467,45 @@ int main() {
         }
         ImGui::End();
 
+        // Window 3 long history. Only the visible range is queried, at one
+        // point per pixel column, so the cost does not grow with the history.
+        ImGui::SetNextWindowPos(ImVec2(0, 800), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(900, 300), ImGuiCond_Always);
+
+        ImGui::Begin("history", nullptr, flags);
+        static int hist_axis = 2;
+        static int hist_seconds = 60;
+        static bool follow = true;
+        ImGui::SliderInt("axis (x/y/z)", &hist_axis, 0, 2);
+        ImGui::SliderInt("span (s at 100 Hz)", &hist_seconds, 1, 3600);
+        ImGui::Checkbox("Follow live (off: drag/zoom the plot)", &follow);
+
+        const historyStore& h = raw.hist[hist_axis];
+        const historyStore& h_d = raw.hist_d[hist_axis];
+        if (ImPlot::BeginPlot("##history", ImVec2(-1, 200))) {
+            const double newest = static_cast<double>(h.size());
+            if (follow) {
+                ImPlot::SetupAxisLimits(ImAxis_X1, newest - 100.0 * hist_seconds, newest, ImGuiCond_Always);
+            }
+            ImPlot::SetupAxisLimits(ImAxis_Y1, -y_max, y_max, ImGuiCond_Always);
+
+            const ImPlotRect lim = ImPlot::GetPlotLimits();
+            const int columns = std::max(1, static_cast<int>(ImPlot::GetPlotSize().x));
+            const auto begin = static_cast<std::uint64_t>(std::max(0.0, lim.X.Min));
+            const auto end = static_cast<std::uint64_t>(std::max(0.0, lim.X.Max)) + 1;
+
+            int n = static_cast<int>(h.envelope(begin, end, columns, hist_x, hist_lo, hist_hi));
+            if (n > 0) ImPlot::PlotShaded("raw min/max", hist_x.data(), hist_lo.data(), hist_hi.data(), n);
+            n = static_cast<int>(h.lttb(begin, end, columns, hist_x, hist_y));
+            if (n > 1) ImPlot::PlotLine("raw", hist_x.data(), hist_y.data(), n);
+            if (show_denoised) {
+                n = static_cast<int>(h_d.lttb(begin, end, columns, hist_x, hist_y));
+                if (n > 1) ImPlot::PlotLine("den", hist_x.data(), hist_y.data(), n);
+            }
+            ImPlot::EndPlot();
+        }
+        ImGui::End();
+
         // Render
         ImGui::Render();
         int display_w, display_h;
@@ -379,6 +523,7 @@ int main() {
     // ----------------------
     running.store(false);
     if (rx.joinable()) rx.join();
+    if (latency::enabled) latency::report(stderr);
 
     ImPlot::DestroyContext();
     ImGui_ImplOpenGL3_Shutdown();
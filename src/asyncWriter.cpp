@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "asyncWriter.hpp"
+
+asyncWriter::asyncWriter(int fd, std::size_t capacity, policy p) : fd_(fd), policy_(p)
+{
+    std::size_t cap = 4096;
+    while (cap < capacity) cap *= 2;
+    ring_.resize(cap);
+    mask_ = cap - 1;
+    th_ = std::thread([this] { run_(); });
+}
+
+asyncWriter::~asyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        stop_ = true;
+    }
+    data_.notify_one();
+    th_.join();
+}
+
+bool asyncWriter::write(const char* p, std::size_t n)
+{
+    if (n == 0) return true;
+    std::lock_guard<std::mutex> order(producers_);
+    std::unique_lock<std::mutex> g(lock_);
+
+    if (policy_ == policy::drop && n > ring_.size() - (head_ - tail_)) {
+        dropped_bytes_.fetch_add(n, std::memory_order_relaxed);
+        dropped_batches_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // A batch larger than the ring goes in ring-sized pieces
+    while (n > 0) {
+        space_.wait(g, [this] { return head_ - tail_ < ring_.size(); });
+        const std::size_t room = ring_.size() - static_cast<std::size_t>(head_ - tail_);
+        const std::size_t m = std::min(n, room);
+        const std::size_t at = static_cast<std::size_t>(head_) & mask_;
+        const std::size_t first = std::min(m, ring_.size() - at);
+        std::memcpy(&ring_[at], p, first);
+        std::memcpy(&ring_[0], p + first, m - first);
+        head_ += m;
+        buffered_.store(static_cast<std::size_t>(head_ - tail_), std::memory_order_relaxed);
+        p += m;
+        n -= m;
+        if (n == 0 && tap_) ends_.push_back(head_);
+        data_.notify_one();
+    }
+    return true;
+}
+
+void asyncWriter::flush()
+{
+    std::unique_lock<std::mutex> g(lock_);
+    const std::uint64_t target = head_;
+    space_.wait(g, [this, target] { return tail_ >= target; });
+}
+
+void asyncWriter::run_()
+{
+    std::unique_lock<std::mutex> g(lock_);
+    while (true) {
+        data_.wait(g, [this] { return head_ != tail_ || stop_; });
+        if (head_ == tail_) return;  // stopping and drained
+
+        const std::uint64_t from = tail_, to = head_;
+        g.unlock();
+        write_out_(from, to);
+        g.lock();
+        tail_ = to;
+        buffered_.store(static_cast<std::size_t>(head_ - tail_), std::memory_order_relaxed);
+        space_.notify_all();
+    }
+}
+
+void asyncWriter::write_out_(std::uint64_t from, std::uint64_t to)
+{
+    const std::size_t n = static_cast<std::size_t>(to - from);
+    const std::size_t at = static_cast<std::size_t>(from) & mask_;
+    const std::size_t first = std::min(n, ring_.size() - at);
+    iovec iov[2] = {{&ring_[at], first}, {&ring_[0], n - first}};
+
+    if (tap_) tap_out_(from, to);
+    if (fd_ < 0 || failed_) return;  // keep draining so producers never hang
+    iovec* v = iov;
+    int count = n > first ? 2 : 1;
+
+    while (count > 0) {
+        const ssize_t k = ::writev(fd_, v, count);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            std::perror("write");
+            failed_ = true;
+            return;
+        }
+        written_.fetch_add(static_cast<std::uint64_t>(k), std::memory_order_relaxed);
+        std::size_t done = static_cast<std::size_t>(k);
+        while (count > 0 && done >= v->iov_len) {
+            done -= v->iov_len;
+            ++v;
+            --count;
+        }
+        if (count > 0) {
+            v->iov_base = static_cast<char*>(v->iov_base) + done;
+            v->iov_len -= done;
+        }
+    }
+}
+
+void asyncWriter::tap_out_(std::uint64_t from, std::uint64_t to)
+{
+    while (from < to) {
+        // As many whole batches as fit in tap_bytes, at least one. Without
+        // an end in range, this is part of a batch larger than the ring.
+        std::uint64_t end = from;
+        {
+            std::lock_guard<std::mutex> g(lock_);
+            while (!ends_.empty() && ends_.front() <= to && (end == from || ends_.front() - from <= tap_bytes)) {
+                end = ends_.front();
+                ends_.pop_front();
+            }
+        }
+        if (end == from) end = to;
+
+        const std::size_t n = static_cast<std::size_t>(end - from);
+        const std::size_t at = static_cast<std::size_t>(from) & mask_;
+        const std::size_t first = std::min(n, ring_.size() - at);
+        const span pieces[2] = {{&ring_[at], first}, {&ring_[0], n - first}};
+        tap_(pieces, n > first ? 2 : 1);
+        from = end;
+    }
+}
@@ -0,0 +1,295 @@
+#include <array>
+#include <cmath>
+#include "batchDenoiser.hpp"
+#include "sortNetwork.hpp"
+
+namespace {
+    // One tile row as a single SIMD value (GCC/Clang vector extension). With
+    // lanes = 8 this is one zmm register on AVX-512 and two ymm on AVX2.
+    // Rows are only double aligned, and are accessed through references so no
+    // vector ever crosses a function boundary by value.
+    typedef double vec_t
+        __attribute__((vector_size(sizeof(double) * batchDenoiser::lanes), aligned(sizeof(double)), may_alias));
+    typedef long long mask_t
+        __attribute__((vector_size(sizeof(double) * batchDenoiser::lanes)));
+
+    inline const vec_t& row(const double* p) { return *reinterpret_cast<const vec_t*>(p); }
+    inline vec_t& row(double* p) { return *reinterpret_cast<vec_t*>(p); }
+
+    // Compare-exchange of two rows for the sorting networks. Done in pieces of
+    // the target's register width: GCC splits a compare on a wider vector
+    // into one scalar compare per lane.
+#if defined(__AVX512F__)
+    constexpr int piece = 8;
+#elif defined(__AVX__)
+    constexpr int piece = 4;
+#else
+    constexpr int piece = 2;
+#endif
+    typedef double piece_t
+        __attribute__((vector_size(sizeof(double) * piece), aligned(sizeof(double)), may_alias));
+    typedef long long piece_mask_t
+        __attribute__((vector_size(sizeof(double) * piece)));
+
+    struct row_cmpswap {
+        void operator()(vec_t& a, vec_t& b) const {
+            for (int i = 0; i < batchDenoiser::lanes; i += piece) {
+                piece_t& x = *reinterpret_cast<piece_t*>(reinterpret_cast<double*>(&a) + i);
+                piece_t& y = *reinterpret_cast<piece_t*>(reinterpret_cast<double*>(&b) + i);
+                const piece_mask_t m = y < x;
+                const piece_mask_t ix = (piece_mask_t)x, iy = (piece_mask_t)y;
+                x = (piece_t)((m & iy) | (~m & ix));
+                y = (piece_t)((m & ix) | (~m & iy));
+            }
+        }
+    };
+}
+
+batchDenoiser::batchDenoiser(int streams)
+    : streams_(streams),
+      tiles_((streams + lanes - 1) / lanes)
+{
+    const std::size_t padded = static_cast<std::size_t>(tiles_) * lanes;
+    const std::size_t ring_size = padded * windowSize;
+    t_.assign(ring_size, 0.0);
+    ax_.assign(ring_size, 0.0);
+    ay_.assign(ring_size, 0.0);
+    az_.assign(ring_size, 0.0);
+    idx_.assign(padded, 0);
+    count_.assign(padded, 0);
+    hop_counter_.assign(padded, 0);
+
+    ola_x_acc_.assign(ring_size, 0.0); ola_x_wsum_.assign(ring_size, 0.0);
+    ola_y_acc_.assign(ring_size, 0.0); ola_y_wsum_.assign(ring_size, 0.0);
+    ola_z_acc_.assign(ring_size, 0.0); ola_z_wsum_.assign(ring_size, 0.0);
+
+    out_x_.assign(padded * hop, 0.0);
+    out_y_.assign(padded * hop, 0.0);
+    out_z_.assign(padded * hop, 0.0);
+    emitted_.assign(padded, 0);
+
+    // must match denoiser::denoiser() exactly
+    constexpr double pi = 3.1415926;
+    for (int n = 0; n < windowSize; ++n) {
+        win_[n] = 0.5 - 0.5 * std::cos(2.0 * pi * n / (windowSize - 1));
+    }
+}
+
+void batchDenoiser::push(int stream, double t, double ax, double ay, double az)
+{
+    // overwrite oldest slot, then move idx forward
+    const std::size_t at = slot_(idx_[stream], stream);
+    t_[at]  = t;
+    ax_[at] = ax;
+    ay_[at] = ay;
+    az_[at] = az;
+
+    idx_[stream] = (idx_[stream] + 1) % windowSize;
+    if (count_[stream] < windowSize) count_[stream]++;
+    hop_counter_[stream]++;
+}
+
+bool batchDenoiser::ready_(int stream) const
+{
+    return count_[stream] >= windowSize && hop_counter_[stream] >= hop;
+}
+
+int batchDenoiser::denoise()
+{
+    int emitted = 0;
+    for (int tile = 0; tile < tiles_; ++tile) {
+        bool mask[lanes];
+        bool any = false;
+        for (int l = 0; l < lanes; ++l) {
+            const int s = tile * lanes + l;
+            mask[l] = s < streams_ && ready_(s);
+            emitted_[s] = mask[l] ? 1 : 0;
+            if (!mask[l]) continue;
+            any = true;
+            ++emitted;
+            hop_counter_[s] = 0;
+        }
+        if (any) denoise_tile_(tile, mask);
+    }
+    return emitted;
+}
+
+void batchDenoiser::denoise_tile_(int tile, const bool* mask)
+{
+    alignas(64) tile_t wx[windowSize], wy[windowSize], wz[windowSize];
+    const std::size_t base = slot_(0, tile * lanes);
+
+    // 1) Forward transform straight out of the rings (no time-ordered copy)
+    haar_dwt_(&ax_[base], &idx_[tile * lanes], wx);
+    haar_dwt_(&ay_[base], &idx_[tile * lanes], wy);
+    haar_dwt_(&az_[base], &idx_[tile * lanes], wz);
+
+    // 2) Threshold + inverse transform, all lanes at once
+    threshold_(wx);
+    threshold_(wy);
+    threshold_(wz);
+    haar_idwt_(wx);
+    haar_idwt_(wy);
+    haar_idwt_(wz);
+
+    // 3-4) WOLA shift + add, committed only for lanes that are ready
+    add_block_wola_(&ola_x_acc_[base], &ola_x_wsum_[base], wx, mask);
+    add_block_wola_(&ola_y_acc_[base], &ola_y_wsum_[base], wy, mask);
+    add_block_wola_(&ola_z_acc_[base], &ola_z_wsum_[base], wz, mask);
+
+    // 5) Emit hop samples (normalized)
+    for (int l = 0; l < lanes; ++l) {
+        if (!mask[l]) continue;
+        const int s = tile * lanes + l;
+        for (int k = 0; k < hop; ++k) {
+            const std::size_t at = base + static_cast<std::size_t>(k) * lanes + l;
+            out_x_[s * hop + k] = (ola_x_wsum_[at] > 1e-12) ? (ola_x_acc_[at] / ola_x_wsum_[at]) : 0.0;
+            out_y_[s * hop + k] = (ola_y_wsum_[at] > 1e-12) ? (ola_y_acc_[at] / ola_y_wsum_[at]) : 0.0;
+            out_z_[s * hop + k] = (ola_z_wsum_[at] > 1e-12) ? (ola_z_acc_[at] / ola_z_wsum_[at]) : 0.0;
+        }
+    }
+}
+
+void batchDenoiser::haar_dwt_(const double* ring, const int* idx, tile_t* w) const
+{
+    using scalar = denoiser<>;
+    const vec_t half          = vec_t{} + 0.5;
+    const vec_t sqrt2         = vec_t{} + scalar::sqrt2;
+    const vec_t neg_inv_sqrt2 = vec_t{} - scalar::inv_sqrt2;
+
+    // denoiser<>::lift_pair on vectors, same operation order
+    auto lift = [&](const vec_t& e, const vec_t& o, vec_t& s, vec_t& d) {
+        const vec_t p = o - e;
+        const vec_t u = e + half * p;
+        s = u * sqrt2;
+        d = p * neg_inv_sqrt2;
+    };
+
+    // Level 1 reads the rings in place. When every lane has the same oldest
+    // slot a ring row is one vector load, otherwise gather per lane.
+    bool lockstep = true;
+    for (int l = 1; l < lanes; ++l) lockstep = lockstep && idx[l] == idx[0];
+
+    for (int j = 0; j < windowSize; j += 2) {
+        vec_t a, b;
+        if (lockstep) {
+            a = row(ring + static_cast<std::size_t>((idx[0] + j) % windowSize) * lanes);
+            b = row(ring + static_cast<std::size_t>((idx[0] + j + 1) % windowSize) * lanes);
+        } else {
+            for (int l = 0; l < lanes; ++l) {
+                a[l] = ring[static_cast<std::size_t>((idx[l] + j) % windowSize) * lanes + l];
+                b[l] = ring[static_cast<std::size_t>((idx[l] + j + 1) % windowSize) * lanes + l];
+            }
+        }
+        lift(a, b, row(w[j]), row(w[j + 1]));
+    }
+
+    // Levels 2..L in place, same interleaved layout as denoiser
+    for (int step = 2; step < (1 << levels); step *= 2) {
+        for (int e = 0; e < windowSize; e += 2 * step) {
+            const vec_t a = row(w[e]);
+            const vec_t b = row(w[e + step]);
+            lift(a, b, row(w[e]), row(w[e + step]));
+        }
+    }
+}
+
+void batchDenoiser::haar_idwt_(tile_t* w) const
+{
+    using scalar = denoiser<>;
+    const vec_t half      = vec_t{} + 0.5;
+    const vec_t inv_sqrt2 = vec_t{} + scalar::inv_sqrt2;
+    const vec_t neg_sqrt2 = vec_t{} - scalar::sqrt2;
+
+    // denoiser<>::unlift_pair on vectors, same operation order
+    auto unlift = [&](const vec_t& s, const vec_t& d, vec_t& e, vec_t& o) {
+        const vec_t u = s * inv_sqrt2;
+        const vec_t p = d * neg_sqrt2;
+        const vec_t even = u - half * p;
+        o = p + even;
+        e = even;
+    };
+
+    for (int step = 1 << (levels - 1); step >= 1; step /= 2) {
+        for (int e = 0; e < windowSize; e += 2 * step) {
+            const vec_t s = row(w[e]);
+            const vec_t d = row(w[e + step]);
+            unlift(s, d, row(w[e]), row(w[e + step]));
+        }
+    }
+}
+
+void batchDenoiser::threshold_(tile_t* w) const
+{
+    using scalar = denoiser<>;
+    constexpr int D1_len = scalar::detail_length(1);
+
+    // Noise estimate: denoiser's sigma_estimator::network run on all lanes at
+    // once. Every D1 coefficient is already one row of lanes.
+    const mask_t sign_bit = mask_t{} + static_cast<long long>(0x8000000000000000ull);
+    const vec_t half = vec_t{} + 0.5;
+    vec_t s[D1_len], d[D1_len];
+    for (int k = 0; k < D1_len; ++k) {
+        s[k] = row(w[scalar::detail_offset(1) + k * scalar::detail_stride(1)]);
+    }
+    sortnet::bitonic_sort<D1_len>(s, row_cmpswap{});
+    const vec_t med = half * (s[D1_len / 2] + s[D1_len / 2 - 1]);
+    for (int k = 0; k < D1_len / 2; ++k) {
+        d[k]              = (vec_t)((mask_t)(s[D1_len / 2 - 1 - k] - med) & ~sign_bit);
+        d[D1_len / 2 + k] = (vec_t)((mask_t)(s[D1_len - 1 - k] - med) & ~sign_bit);
+    }
+    sortnet::bitonic_merge<D1_len>(d, row_cmpswap{});
+    const vec_t sigma = half * (d[D1_len / 2] + d[D1_len / 2 - 1]) / 0.6745;
+
+    const double universal = std::sqrt(2.0 * std::log(static_cast<double>(windowSize)));
+    const mask_t apply = sigma > 0.0;
+    const vec_t T = sigma * universal;
+
+    // Soft threshold: sign(x)*max(|x|-T,0), scaled per level like denoise_axis_.
+    // Done on the bit patterns so it stays branch free: for |x| > T the
+    // result is (|x|-T) carrying the sign of x, otherwise +0.0.
+    for (int level = 1; level <= levels; ++level) {
+        const vec_t Tl = scalar::level_scale(level) * T;
+        const int stride = scalar::detail_stride(level);
+        for (int k = 0; k < scalar::detail_length(level); ++k) {
+            double* c = w[scalar::detail_offset(level) + k * stride];
+            const mask_t xb = (mask_t)row(c);
+            const vec_t ax  = (vec_t)(xb & ~sign_bit);
+            const mask_t keep = ax > Tl;
+            const mask_t y = keep & ((mask_t)(ax - Tl) | (xb & sign_bit));
+            row(c) = (vec_t)((apply & y) | (~apply & xb));
+        }
+    }
+}
+
+void batchDenoiser::add_block_wola_(double* acc, double* wsum, const tile_t* block,
+                                    const bool* mask) const
+{
+    // acc[n] <- acc[n + hop] + block[n] * w[n]  (shift_left_hop_ + add_block_wola_ fused).
+    // Reading row n + hop before it is overwritten keeps this in place.
+    bool all = true;
+    for (int l = 0; l < lanes; ++l) all = all && mask[l];
+
+    for (int n = 0; n < windowSize; ++n) {
+        double* a  = acc  + static_cast<std::size_t>(n) * lanes;
+        double* ws = wsum + static_cast<std::size_t>(n) * lanes;
+        const bool tail = n >= windowSize - hop;
+        const std::size_t next = static_cast<std::size_t>(hop) * lanes;
+
+        if (all) {
+            const vec_t w = vec_t{} + win_[n];
+            const vec_t base_a  = tail ? vec_t{} : row(a + next);
+            const vec_t base_ws = tail ? vec_t{} : row(ws + next);
+            row(a)  = base_a + row(block[n]) * w;
+            row(ws) = base_ws + w;
+            continue;
+        }
+        // lanes that are not due keep their accumulators untouched
+        for (int l = 0; l < lanes; ++l) {
+            if (!mask[l]) continue;
+            const double w = win_[n];
+            a[l]  = (tail ? 0.0 : a[next + l]) + block[n][l] * w;
+            ws[l] = (tail ? 0.0 : ws[next + l]) + w;
+        }
+    }
+}
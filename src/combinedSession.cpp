@@ -0,0 +1,107 @@
+#include "combinedSession.hpp"
+
+namespace {
+    // The quoted string value after `key` in line, or empty
+    std::string_view string_member(std::string_view line, std::string_view key)
+    {
+        std::size_t p = line.find(key);
+        if (p == std::string_view::npos) return {};
+        p += key.size();
+        auto skip_ws = [&] {
+            while (p < line.size() && (line[p] == ' ' || line[p] == '\t')) ++p;
+        };
+        skip_ws();
+        if (p == line.size() || line[p] != ':') return {};
+        ++p;
+        skip_ws();
+        if (p == line.size() || line[p] != '"') return {};
+        const std::size_t end = line.find('"', ++p);
+        if (end == std::string_view::npos) return {};
+        return line.substr(p, end - p);
+    }
+}
+
+messageType classify_line(std::string_view line)
+{
+    const std::string_view type = string_member(line, "\"type\"");
+    if (type == "imu") return messageType::imu;
+    if (type == "gps") return messageType::gps;
+    if (!type.empty()) return messageType::unknown;
+
+    if (line.find("\"quat\"") != std::string_view::npos) return messageType::imu;
+    if (line.find("\"lat\"") != std::string_view::npos) return messageType::gps;
+    return messageType::unknown;
+}
+
+combinedSession::~combinedSession()
+{
+    // whatever the join still holds goes out with the sessions' last output
+    if (join_) {
+        join_->flush();
+        drain_join_();
+    }
+    on_idle();
+}
+
+void combinedSession::joinTap::imu(const IMUsample& s)
+{
+    c_.sink_.imu(s);
+    if (!c_.join_) return;
+    c_.join_->imu(s);
+    c_.drain_join_();
+}
+
+void combinedSession::joinTap::gps(const GPSsample& s)
+{
+    c_.sink_.gps(s);
+    if (!c_.join_) return;
+    c_.join_->gps(s);
+    c_.drain_join_();
+}
+
+void combinedSession::drain_join_()
+{
+    streamJoin::joined j;
+    while (join_->next(j)) sink_.joined(j);
+}
+
+void combinedSession::on_line(std::string_view line)
+{
+    if (line.empty()) return;
+    const std::size_t bytes = line.size() + 1;  // with its newline
+    if (classify_line(line) == messageType::gps) {
+        gps_.on_read(bytes);
+        gps_.on_line(line);
+    } else {
+        imu_.on_read(bytes);
+        imu_.on_line(line);
+    }
+}
+
+void combinedSession::on_frame(const wire::header& h, std::string_view payload)
+{
+    const std::size_t bytes = wire::header_size + payload.size();
+    if (h.k == wire::kind::gps) {
+        gps_.on_read(bytes);
+        gps_.on_frame(h, payload);
+    } else {
+        imu_.on_read(bytes);
+        imu_.on_frame(h, payload);
+    }
+}
+
+void combinedSession::on_idle()
+{
+    imu_.flush();
+    gps_.flush();
+    sink_.flush();
+}
+
+bool combinedSession::record(const std::string& path)
+{
+    auto rec = std::make_shared<sessionRecorder>();
+    if (!rec->open(path)) return false;
+    imu_.record(rec);
+    gps_.record(rec);
+    return true;
+}
@@ -0,0 +1,212 @@
+#include <cmath>
+#include "fusionEngine.hpp"
+
+namespace {
+    constexpr double g0 = 9.80665;                 // m/s^2 per g
+    constexpr double deg = M_PI / 180.0;
+
+    // WGS84
+    constexpr double wgs84_a = 6378137.0;
+    constexpr double wgs84_e2 = 6.69437999014e-3;
+
+    // Prior spread of what the first fix does not tell
+    constexpr double start_speed_sd = 2.0;         // m/s, per axis
+    constexpr double start_bias_sd = 0.2;          // m/s^2
+    constexpr double no_vacc_sd = 1e4;             // m, when vAcc is not valid
+
+    // Indices into the error state
+    constexpr int P0 = 0, V0 = 3, B0 = 6;
+
+    bool speed_valid(const GPSsample& g)
+    {
+        return g.getSpeed() >= 0.0 && g.getCourse() >= 0.0;
+    }
+}
+
+void fusionFilter::predict(double t, double x, double y, double z)
+{
+    if (!ready_) return;
+    const double dt = t - x_.t;
+    if (!(dt > 0.0)) return;
+
+    const double a[3] = {x, y, z};
+    const bool coast = dt > opt_.max_dt;
+    for (int i = 0; i < 3; ++i) a_[i] = coast ? 0.0 : g0 * a[i] - x_.bias[i];
+    propagate_(dt);
+    x_.t = t;
+}
+
+void fusionFilter::propagate_(double dt)
+{
+    // nominal state, constant acceleration over the step
+    const double h = 0.5 * dt * dt;
+    for (int i = 0; i < 3; ++i) {
+        x_.p[i] += x_.v[i] * dt + a_[i] * h;
+        x_.v[i] += a_[i] * dt;
+    }
+
+    // P := F P F^T + Q, where F = I except
+    //   dp/dv = dt, dp/db = -dt^2/2, dv/db = -dt (per axis).
+    // F is that sparse, so F P and then (F P) F^T are row and column
+    // operations: O(N^2) instead of two N^3 products.
+    matrix& P = P_;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < N; ++j) {
+            P(P0 + i, j) += dt * P(V0 + i, j) - h * P(B0 + i, j);
+            P(V0 + i, j) -= dt * P(B0 + i, j);
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int r = 0; r < N; ++r) {
+            P(r, P0 + i) += dt * P(r, V0 + i) - h * P(r, B0 + i);
+            P(r, V0 + i) -= dt * P(r, B0 + i);
+        }
+    }
+
+    // white acceleration noise integrated over the step, bias random walk
+    const double qa = opt_.accel_noise * opt_.accel_noise;
+    const double qb = opt_.bias_walk * opt_.bias_walk;
+    for (int i = 0; i < 3; ++i) {
+        P(P0 + i, P0 + i) += qa * dt * dt * dt / 3.0;
+        P(P0 + i, V0 + i) += qa * h;
+        P(V0 + i, P0 + i) += qa * h;
+        P(V0 + i, V0 + i) += qa * dt;
+        P(B0 + i, B0 + i) += qb * dt;
+    }
+}
+
+bool fusionFilter::correct(const GPSsample& g)
+{
+    if (!std::isfinite(g.getLatitude()) || !std::isfinite(g.getLongitude()) ||
+        !std::isfinite(g.getAltitude()) || !(g.getHAcc() > 0.0)) {
+        ++rejected_;
+        return false;
+    }
+    if (!ready_) {
+        start_(g);
+        return true;
+    }
+
+    // bring the filter up to the fix, on the last acceleration
+    const double dt = g.getTime() - x_.t;
+    if (dt > 0.0) {
+        if (dt > opt_.max_dt) for (double& a : a_) a = 0.0;
+        propagate_(dt);
+        x_.t = g.getTime();
+    }
+
+    double dlon = g.getLongitude() - lon0_;
+    if (dlon > 180.0) dlon -= 360.0;
+    if (dlon < -180.0) dlon += 360.0;
+    const double z[3] = {
+        dlon * deg * m_per_rad_e_,
+        (g.getLatitude() - lat0_) * deg * m_per_rad_n_,
+        g.getAltitude() - alt0_,
+    };
+    const double hvar = g.getHAcc() * g.getHAcc();
+    const double vsd = g.getVAcc() > 0.0 ? g.getVAcc() : no_vacc_sd;
+
+    bool ok;
+    if (speed_valid(g)) {
+        // position and horizontal velocity
+        fixedMatrix<5, N> H;
+        fixedMatrix<5, 5> R;
+        double nu[5];
+        for (int i = 0; i < 3; ++i) {
+            H(i, P0 + i) = 1.0;
+            nu[i] = z[i] - x_.p[i];
+        }
+        H(3, V0) = 1.0;
+        H(4, V0 + 1) = 1.0;
+        nu[3] = g.getSpeed() * std::sin(g.getCourse() * deg) - x_.v[0];
+        nu[4] = g.getSpeed() * std::cos(g.getCourse() * deg) - x_.v[1];
+        R(0, 0) = R(1, 1) = hvar;
+        R(2, 2) = vsd * vsd;
+        R(3, 3) = R(4, 4) = opt_.speed_noise * opt_.speed_noise;
+        ok = update_(H, nu, R);
+    } else {
+        fixedMatrix<3, N> H;
+        fixedMatrix<3, 3> R;
+        double nu[3];
+        for (int i = 0; i < 3; ++i) {
+            H(i, P0 + i) = 1.0;
+            nu[i] = z[i] - x_.p[i];
+        }
+        R(0, 0) = R(1, 1) = hvar;
+        R(2, 2) = vsd * vsd;
+        ok = update_(H, nu, R);
+    }
+    if (ok) ++fixes_;
+    else ++rejected_;
+    return ok;
+}
+
+template <int M>
+bool fusionFilter::update_(const fixedMatrix<M, N>& H, const double* innovation, const fixedMatrix<M, M>& R)
+{
+    const fixedMatrix<N, M> PHt = P_ * H.transposed();
+    fixedMatrix<M, M> S = H * PHt + R;
+    if (!invert(S)) return false;
+    const fixedMatrix<N, M> K = PHt * S;
+
+    // error state estimate, injected into the nominal state; the reset is
+    // the identity, so P needs no further transform
+    double dx[N] = {};
+    for (int r = 0; r < N; ++r)
+        for (int c = 0; c < M; ++c) dx[r] += K(r, c) * innovation[c];
+    for (int i = 0; i < 3; ++i) {
+        x_.p[i] += dx[P0 + i];
+        x_.v[i] += dx[V0 + i];
+        x_.bias[i] += dx[B0 + i];
+    }
+
+    // Joseph form, which keeps P symmetric positive definite in rounding
+    const matrix IKH = matrix::identity() - K * H;
+    P_ = IKH * P_ * IKH.transposed() + K * R * K.transposed();
+    for (int r = 0; r < N; ++r)
+        for (int c = r + 1; c < N; ++c) P_(r, c) = P_(c, r) = 0.5 * (P_(r, c) + P_(c, r));
+    return true;
+}
+
+void fusionFilter::start_(const GPSsample& g)
+{
+    lat0_ = g.getLatitude();
+    lon0_ = g.getLongitude();
+    alt0_ = g.getAltitude();
+    const double s = std::sin(lat0_ * deg);
+    const double w = 1.0 - wgs84_e2 * s * s;
+    const double rn = wgs84_a / std::sqrt(w);                        // prime vertical
+    const double rm = wgs84_a * (1.0 - wgs84_e2) / (w * std::sqrt(w));  // meridian
+    m_per_rad_n_ = rm + alt0_;
+    m_per_rad_e_ = (rn + alt0_) * std::cos(lat0_ * deg);
+
+    x_ = state();
+    x_.t = g.getTime();
+    for (double& a : a_) a = 0.0;
+    P_ = matrix();
+
+    const double vsd = g.getVAcc() > 0.0 ? g.getVAcc() : no_vacc_sd;
+    P_(P0, P0) = P_(P0 + 1, P0 + 1) = g.getHAcc() * g.getHAcc();
+    P_(P0 + 2, P0 + 2) = vsd * vsd;
+    for (int i = 0; i < 3; ++i) {
+        P_(V0 + i, V0 + i) = start_speed_sd * start_speed_sd;
+        P_(B0 + i, B0 + i) = start_bias_sd * start_bias_sd;
+    }
+    if (speed_valid(g)) {
+        x_.v[0] = g.getSpeed() * std::sin(g.getCourse() * deg);
+        x_.v[1] = g.getSpeed() * std::cos(g.getCourse() * deg);
+        P_(V0, V0) = P_(V0 + 1, V0 + 1) = opt_.speed_noise * opt_.speed_noise;
+    }
+
+    ready_ = true;
+    ++fixes_;
+}
+
+void fusionFilter::geodetic(double& lat, double& lon, double& alt) const
+{
+    lat = lat0_ + x_.p[1] / m_per_rad_n_ / deg;
+    lon = lon0_ + (m_per_rad_e_ > 0.0 ? x_.p[0] / m_per_rad_e_ / deg : 0.0);
+    if (lon > 180.0) lon -= 360.0;
+    if (lon < -180.0) lon += 360.0;
+    alt = alt0_ + x_.p[2];
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "historyStore.hpp"
+
+historyStore::historyStore(std::size_t capacity)
+{
+    capacity_ = 4;
+    while (capacity_ < capacity) capacity_ *= 4;
+    raw_.resize(capacity_);
+
+    // level k: one node per 4^k samples, as many as cover capacity_ samples
+    for (std::size_t span = 4; span <= capacity_; span *= 4) {
+        level lv;
+        lv.ring.resize(capacity_ / span);
+        lv.mask = lv.ring.size() - 1;
+        levels_.push_back(std::move(lv));
+    }
+}
+
+void historyStore::carry_(int k, float lo, float hi, double sum)
+{
+    // adds one complete child (a sample, or a node of level k - 1) to level k
+    while (k <= static_cast<int>(levels_.size())) {
+        level& lv = levels_[k - 1];
+        if (lv.filled == 0) {
+            lv.lo = lo;
+            lv.hi = hi;
+            lv.sum = sum;
+        } else {
+            lv.lo = std::min(lv.lo, lo);
+            lv.hi = std::max(lv.hi, hi);
+            lv.sum += sum;
+        }
+        if (++lv.filled < 4) return;
+
+        const double span = std::ldexp(1.0, 2 * k);
+        lv.ring[lv.done & lv.mask] = node{lv.lo, lv.hi, static_cast<float>(lv.sum / span)};
+        ++lv.done;
+        lv.filled = 0;
+
+        // and the finished node goes up as a child of level k + 1
+        lo = lv.lo;
+        hi = lv.hi;
+        sum = lv.sum;
+        ++k;
+    }
+}
+
+void historyStore::push(float v)
+{
+    raw_[total_ & (capacity_ - 1)] = v;
+    ++total_;
+    carry_(1, v, v, v);
+}
+
+void historyStore::push(const float* v, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) push(v[i]);
+}
+
+int historyStore::level_for(std::uint64_t span, int columns) const
+{
+    if (columns <= 0) return 0;
+    const std::uint64_t per_column = span / static_cast<std::uint64_t>(columns);
+    int k = 0;
+    while (k < static_cast<int>(levels_.size()) && (std::uint64_t(4) << (2 * k)) <= per_column) ++k;
+    return k;
+}
+
+template <typename F>
+void historyStore::visit_(std::uint64_t begin, std::uint64_t end, int k, F&& f) const
+{
+    if (begin >= end) return;
+    if (k == 0) {
+        for (std::uint64_t i = begin; i < end; ++i) {
+            const float v = raw_[i & (capacity_ - 1)];
+            f(i, std::uint64_t(1), node{v, v, v});
+        }
+        return;
+    }
+
+    // whole level-k nodes inside [begin, end); every one of them is complete
+    // because end <= total_
+    const std::uint64_t span = std::uint64_t(1) << (2 * k);
+    const std::uint64_t a = (begin + span - 1) / span * span;
+    const std::uint64_t b = end / span * span;
+    if (a >= b) {
+        visit_(begin, end, k - 1, f);
+        return;
+    }
+    visit_(begin, a, k - 1, f);
+    const level& lv = levels_[k - 1];
+    for (std::uint64_t n = a / span; n < b / span; ++n) f(n * span, span, lv.ring[n & lv.mask]);
+    visit_(b, end, k - 1, f);
+}
+
+std::size_t historyStore::envelope(std::uint64_t begin, std::uint64_t end, int columns,
+                                   std::vector<double>& x, std::vector<double>& lo,
+                                   std::vector<double>& hi) const
+{
+    begin = std::max(begin, first());
+    end = std::min(end, total_);
+    if (begin >= end || columns <= 0) return 0;
+
+    const std::uint64_t span = end - begin;
+    const std::size_t cols = static_cast<std::size_t>(std::min<std::uint64_t>(columns, span));
+    const double width = static_cast<double>(span) / static_cast<double>(cols);
+
+    x.resize(cols);
+    lo.assign(cols, std::numeric_limits<double>::infinity());
+    hi.assign(cols, -std::numeric_limits<double>::infinity());
+    for (std::size_t c = 0; c < cols; ++c) x[c] = static_cast<double>(begin) + c * width;
+
+    // nodes are at most one column wide, so every column gets at least one
+    visit_(begin, end, level_for(span, static_cast<int>(cols)),
+           [&](std::uint64_t at, std::uint64_t, const node& nd) {
+               const std::size_t c = std::min(cols - 1, static_cast<std::size_t>((at - begin) / width));
+               lo[c] = std::min(lo[c], static_cast<double>(nd.lo));
+               hi[c] = std::max(hi[c], static_cast<double>(nd.hi));
+           });
+    return cols;
+}
+
+std::size_t historyStore::lttb(std::uint64_t begin, std::uint64_t end, int points,
+                               std::vector<double>& x, std::vector<double>& y) const
+{
+    begin = std::max(begin, first());
+    end = std::min(end, total_);
+    x.clear();
+    y.clear();
+    if (begin >= end || points <= 0) return 0;
+
+    // Source series: node means at about 2-8 nodes per output point
+    std::vector<double> sx;
+    std::vector<double> sy;
+    const int k = level_for(end - begin, 2 * points);
+    visit_(begin, end, k, [&](std::uint64_t at, std::uint64_t span, const node& nd) {
+        sx.push_back(static_cast<double>(at) + 0.5 * static_cast<double>(span - 1));
+        sy.push_back(nd.mean);
+    });
+
+    const std::size_t n = sx.size();
+    const std::size_t m = static_cast<std::size_t>(points);
+    if (n <= m) {
+        x = std::move(sx);
+        y = std::move(sy);
+        return n;
+    }
+    if (m < 3) {
+        x.push_back(sx.front());
+        y.push_back(sy.front());
+        if (m == 2) {
+            x.push_back(sx.back());
+            y.push_back(sy.back());
+        }
+        return m;
+    }
+
+    // Largest-triangle-three-buckets: keep the ends, then from each of the
+    // m - 2 buckets the point forming the largest triangle with the point
+    // kept before it and the mean of the next bucket.
+    x.reserve(m);
+    y.reserve(m);
+    x.push_back(sx[0]);
+    y.push_back(sy[0]);
+    const double every = static_cast<double>(n - 2) / static_cast<double>(m - 2);
+    std::size_t kept = 0;
+    for (std::size_t b = 0; b < m - 2; ++b) {
+        const std::size_t from = 1 + static_cast<std::size_t>(b * every);
+        const std::size_t to = 1 + static_cast<std::size_t>((b + 1) * every);
+
+        const std::size_t next_from = to;
+        const std::size_t next_to = std::min(n, 1 + static_cast<std::size_t>((b + 2) * every));
+        double avg_x = sx[n - 1], avg_y = sy[n - 1];
+        if (next_to > next_from) {
+            avg_x = avg_y = 0;
+            for (std::size_t i = next_from; i < next_to; ++i) {
+                avg_x += sx[i];
+                avg_y += sy[i];
+            }
+            avg_x /= static_cast<double>(next_to - next_from);
+            avg_y /= static_cast<double>(next_to - next_from);
+        }
+
+        double best = -1;
+        std::size_t pick = from;
+        for (std::size_t i = from; i < to; ++i) {
+            const double area = std::abs((sx[kept] - avg_x) * (sy[i] - sy[kept]) -
+                                         (sx[kept] - sx[i]) * (avg_y - sy[kept]));
+            if (area > best) {
+                best = area;
+                pick = i;
+            }
+        }
+        x.push_back(sx[pick]);
+        y.push_back(sy[pick]);
+        kept = pick;
+    }
+    x.push_back(sx[n - 1]);
+    y.push_back(sy[n - 1]);
+    return x.size();
+}
@@ -0,0 +1,323 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "ingestServer.hpp"
+#include "latency.hpp"
+#include "lineFramer.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+bool listenAddress::parse(const char* arg)
+{
+    const char* colon = std::strrchr(arg, ':');
+    const char* digits = colon ? colon + 1 : arg;
+    if (*digits == '\0' || std::strspn(digits, "0123456789") != std::strlen(digits)) return false;
+    const long p = std::strtol(digits, nullptr, 10);
+    if (p < 1 || p > 65535) return false;
+    if (colon) host.assign(arg, static_cast<std::size_t>(colon - arg));
+    port = static_cast<int>(p);
+    return true;
+}
+
+bool listenAddress::resolve(sockaddr_in& out) const
+{
+    out = sockaddr_in{};
+    out.sin_family = AF_INET;
+    out.sin_port = htons(static_cast<uint16_t>(port));
+    if (host.empty()) {
+        out.sin_addr.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+    if (::inet_pton(AF_INET, host.c_str(), &out.sin_addr) != 1) {
+        std::fprintf(stderr, "%s: not an IPv4 address\n", host.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string listenAddress::str() const
+{
+    return (host.empty() ? std::string("*") : host) + ":" + std::to_string(port);
+}
+
+struct ingestServer::connection {
+    int fd;
+    int worker;
+    lineFramer framer;
+    std::unique_ptr<handler> h;
+
+    connection(int fd_, int worker_, std::size_t read_size, std::unique_ptr<handler> h_)
+        : fd(fd_), worker(worker_), framer(read_size), h(std::move(h_)) {}
+};
+
+ingestServer::ingestServer(int port, factory make, int threads, std::size_t read_size)
+    : port_(port),
+      make_(std::move(make)),
+      read_size_(read_size),
+      workers_(threads > 0 ? threads : 1)
+{
+    for (auto& w : workers_) w = std::make_unique<worker>();
+}
+
+ingestServer::~ingestServer()
+{
+    stop();
+    for (auto& w : workers_) {
+        if (w->th.joinable()) w->th.join();
+        // run() was never called, or returned early
+        while (!w->live.empty()) close_(*w->live.begin());
+        if (w->epfd >= 0) ::close(w->epfd);
+        if (w->listen_fd >= 0) ::close(w->listen_fd);
+    }
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
+
+#ifdef __linux__
+
+int ingestServer::listen_socket_() const
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { std::perror("socket"); return -1; }
+
+    const int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuseport_ && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        std::perror("SO_REUSEPORT");
+        ::close(fd);
+        return -1;
+    }
+
+    sockaddr_in addr;
+    if (!listenAddress{host_, port_}.resolve(addr)) {
+        ::close(fd);
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("bind");
+        ::close(fd);
+        return -1;
+    }
+    if (::listen(fd, SOMAXCONN) != 0) {
+        std::perror("listen");
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool ingestServer::start()
+{
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) { std::perror("eventfd"); return false; }
+
+    for (std::size_t i = 0; i < workers_.size(); ++i) {
+        worker& w = *workers_[i];
+        w.epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (w.epfd < 0) { std::perror("epoll_create1"); return false; }
+
+        // Level triggered and never drained, so one write wakes every worker
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &wake_tag_;
+        if (::epoll_ctl(w.epfd, EPOLL_CTL_ADD, wake_fd_, &ev) != 0) {
+            std::perror("epoll_ctl");
+            return false;
+        }
+        if (i == 0 || reuseport_) {
+            w.listen_fd = listen_socket_();
+            if (w.listen_fd < 0) return false;
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.ptr = &listen_tag_;
+            if (::epoll_ctl(w.epfd, EPOLL_CTL_ADD, w.listen_fd, &ev) != 0) {
+                std::perror("epoll_ctl");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ingestServer::run()
+{
+    for (std::size_t i = 1; i < workers_.size(); ++i) {
+        workers_[i]->th = std::thread([this, i] { loop_(static_cast<int>(i)); });
+    }
+    loop_(0);
+    for (std::size_t i = 1; i < workers_.size(); ++i) {
+        if (workers_[i]->th.joinable()) workers_[i]->th.join();
+    }
+}
+
+void ingestServer::stop()
+{
+    if (wake_fd_ < 0) return;
+    const uint64_t one = 1;
+    // only fails if the counter is saturated, which still wakes everyone
+    [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void ingestServer::pin_(int w) const
+{
+    cpu_set_t allowed;
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        std::perror("sched_getaffinity");
+        return;
+    }
+    const int n = CPU_COUNT(&allowed);
+    // w-th allowed CPU, wrapping when there are more workers than CPUs
+    int skip = w % n;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || skip-- > 0) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        const int err = ::pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        if (err != 0) std::fprintf(stderr, "pthread_setaffinity_np: %s\n", std::strerror(err));
+        return;
+    }
+}
+
+void ingestServer::loop_(int w)
+{
+    constexpr int max_events = 256;
+    epoll_event events[max_events];
+    worker& self = *workers_[w];
+    if (pin_cpus_) pin_(w);
+
+    bool running = true;
+    while (running) {
+        const int n = ::epoll_wait(self.epfd, events, max_events, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n && running; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &wake_tag_) {
+                running = false;
+                continue;
+            }
+            if (tag == &listen_tag_) {
+                accept_all_(w);
+                continue;
+            }
+            serve_(static_cast<connection*>(tag));
+        }
+    }
+
+    // Let handlers see the end of their streams
+    std::vector<connection*> left;
+    {
+        std::lock_guard<std::mutex> g(self.lock);
+        left.assign(self.live.begin(), self.live.end());
+    }
+    for (connection* c : left) close_(c);
+}
+
+void ingestServer::accept_all_(int self)
+{
+    // Edge triggered: take everything queued, until accept would block
+    while (true) {
+        const int fd = ::accept4(workers_[self]->listen_fd, nullptr, nullptr,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) std::perror("accept4");
+            return;
+        }
+
+        const unsigned long id = next_id_.fetch_add(1, std::memory_order_relaxed);
+        // a reuseport shard keeps what it accepts
+        const int w = reuseport_ ? self : static_cast<int>(id % workers_.size());
+        auto* c = new connection(fd, w, read_size_, make_(id));
+
+        {
+            std::lock_guard<std::mutex> g(workers_[w]->lock);
+            workers_[w]->live.insert(c);
+        }
+        open_.fetch_add(1, std::memory_order_relaxed);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        // From here on c belongs to worker w
+        if (::epoll_ctl(workers_[w]->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            std::perror("epoll_ctl");
+            close_(c);
+        }
+    }
+}
+
+void ingestServer::serve_(connection* c)
+{
+    // Edge triggered: read until the socket would block, or the peer is gone
+    while (true) {
+        latency::tick t0 = latency::now();
+        const ssize_t n = c->framer.read_from(c->fd);
+        if (n > 0) {
+            latency::record(latency::stage::read, t0);
+            latency::mark_arrival();
+            c->h->on_read(static_cast<std::size_t>(n));
+            wire::message m;
+            t0 = latency::now();
+            while (wire::next(c->framer, m)) {
+                latency::record(latency::stage::frame, t0);
+                if (m.binary) c->h->on_frame(m.hdr, m.payload);
+                else c->h->on_line(m.line);
+                t0 = latency::now();
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            c->h->on_idle();
+            return;
+        }
+        if (n < 0) std::perror("read");
+        close_(c);
+        return;
+    }
+}
+
+#else
+
+bool ingestServer::start()
+{
+    std::fprintf(stderr, "ingestServer: epoll is only available on Linux\n");
+    return false;
+}
+
+void ingestServer::run() {}
+void ingestServer::stop() {}
+int ingestServer::listen_socket_() const { return -1; }
+void ingestServer::pin_(int) const {}
+void ingestServer::loop_(int) {}
+void ingestServer::accept_all_(int) {}
+void ingestServer::serve_(connection*) {}
+
+#endif
+
+void ingestServer::close_(connection* c)
+{
+    {
+        std::lock_guard<std::mutex> g(workers_[c->worker]->lock);
+        workers_[c->worker]->live.erase(c);
+    }
+    // Closing the fd also drops it from its epoll set
+    ::close(c->fd);
+    c->h->on_idle();
+    delete c;
+    open_.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,148 @@
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "latency.hpp"
+
+namespace {
+    std::mutex registry_lock;
+    std::vector<std::unique_ptr<latency::histogram[]>> registry;
+
+    std::atomic<bool> report_requested{false};
+}
+
+namespace latency {
+
+const char* name(stage s)
+{
+    switch (s) {
+    case stage::read: return "read";
+    case stage::frame: return "frame";
+    case stage::parse: return "parse";
+    case stage::push: return "push";
+    case stage::denoise: return "denoise";
+    case stage::emit: return "emit";
+    case stage::plot: return "plot";
+    case stage::end_to_end: return "end_to_end";
+    case stage::count: break;
+    }
+    return "?";
+}
+
+int histogram::index_(tick v)
+{
+    if (v < 64) return static_cast<int>(v);
+    const tick top = (tick(1) << (35 + sub_bits + 1)) - 1;
+    if (v > top) v = top;
+    const int msb = 63 - __builtin_clzll(v);
+    const int shift = msb - sub_bits;
+    return 64 + (shift - 1) * 32 + static_cast<int>((v >> shift) - 32);
+}
+
+tick histogram::upper_(int i)
+{
+    if (i < 64) return static_cast<tick>(i);
+    const int shift = (i - 64) / 32 + 1;
+    const tick sub = static_cast<tick>((i - 64) % 32 + 32);
+    return ((sub + 1) << shift) - 1;
+}
+
+void histogram::record(tick v)
+{
+    auto& c = counts_[index_(v)];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (v > max_.load(std::memory_order_relaxed)) max_.store(v, std::memory_order_relaxed);
+}
+
+void histogram::merge(const histogram& o)
+{
+    for (int i = 0; i < buckets; ++i) {
+        counts_[i].store(counts_[i].load(std::memory_order_relaxed) +
+                         o.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    if (o.max() > max()) max_.store(o.max(), std::memory_order_relaxed);
+}
+
+std::uint64_t histogram::count() const
+{
+    std::uint64_t n = 0;
+    for (const auto& c : counts_) n += c.load(std::memory_order_relaxed);
+    return n;
+}
+
+tick histogram::quantile(double q) const
+{
+    const std::uint64_t n = count();
+    if (n == 0) return 0;
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(n));
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < buckets; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return upper_(i) < max() ? upper_(i) : max();
+    }
+    return max();
+}
+
+histogram* thread_histograms()
+{
+    thread_local histogram* mine = nullptr;
+    if (!mine) {
+        // kept after the thread exits, so its samples stay in the report
+        auto h = std::make_unique<histogram[]>(static_cast<int>(stage::count));
+        mine = h.get();
+        std::lock_guard<std::mutex> g(registry_lock);
+        registry.push_back(std::move(h));
+    }
+    return mine;
+}
+
+void report(std::FILE* out)
+{
+    if (!enabled) {
+        std::fprintf(out, "latency: built without IMU_LATENCY\n");
+        return;
+    }
+    std::unique_ptr<histogram[]> total(new histogram[static_cast<int>(stage::count)]);
+    {
+        std::lock_guard<std::mutex> g(registry_lock);
+        for (const auto& h : registry) {
+            for (int s = 0; s < static_cast<int>(stage::count); ++s) total[s].merge(h[s]);
+        }
+    }
+
+    std::fprintf(out, "latency ns    %12s %10s %10s %10s %10s\n", "count", "p50", "p99", "p999", "max");
+    for (int s = 0; s < static_cast<int>(stage::count); ++s) {
+        const histogram& h = total[s];
+        if (h.count() == 0) continue;
+        std::fprintf(out, "  %-11s %12llu %10llu %10llu %10llu %10llu\n", name(static_cast<stage>(s)),
+                     (unsigned long long)h.count(), (unsigned long long)h.quantile(0.50),
+                     (unsigned long long)h.quantile(0.99), (unsigned long long)h.quantile(0.999),
+                     (unsigned long long)h.max());
+    }
+    std::fflush(out);
+}
+
+void request_report()
+{
+    report_requested.store(true, std::memory_order_relaxed);
+}
+
+void start_reporter(int seconds)
+{
+    std::thread([seconds] {
+        using clock = std::chrono::steady_clock;
+        auto next = clock::now() + std::chrono::seconds(seconds);
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            const bool due = seconds > 0 && clock::now() >= next;
+            if (report_requested.exchange(false, std::memory_order_relaxed) || due) {
+                report(stderr);
+                if (due) next += std::chrono::seconds(seconds);
+            }
+        }
+    }).detach();
+}
+
+} // namespace latency
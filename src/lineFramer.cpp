@@ -0,0 +1,89 @@
+#include <cstring>
+#include <unistd.h>
+#include "lineFramer.hpp"
+
+lineFramer::lineFramer(std::size_t read_size, std::size_t max_line)
+    : buf_(read_size + max_line),
+      read_size_(read_size),
+      max_line_(max_line)
+{
+}
+
+void lineFramer::compact_()
+{
+    // move the partial line (at most max_line bytes) to the front
+    const std::size_t keep = end_ - begin_;
+    if (keep > 0 && begin_ > 0) std::memmove(buf_.data(), buf_.data() + begin_, keep);
+    scan_ -= begin_;
+    end_ = keep;
+    begin_ = 0;
+}
+
+ssize_t lineFramer::read_from(int fd)
+{
+    if (buf_.size() - end_ < read_size_) compact_();
+    const ssize_t n = ::read(fd, buf_.data() + end_, buf_.size() - end_);
+    if (n > 0) end_ += static_cast<std::size_t>(n);
+    return n;
+}
+
+std::size_t lineFramer::append(const char* p, std::size_t n)
+{
+    if (buf_.size() - end_ < read_size_) compact_();
+    const std::size_t m = n < buf_.size() - end_ ? n : buf_.size() - end_;
+    std::memcpy(buf_.data() + end_, p, m);
+    end_ += m;
+    return m;
+}
+
+bool lineFramer::next(std::string_view& line)
+{
+    char* const base = buf_.data();
+    while (true) {
+        const char* nl = static_cast<const char*>(std::memchr(base + scan_, '\n', end_ - scan_));
+
+        if (discarding_) {
+            // rest of an oversized line
+            const std::size_t upto = nl ? static_cast<std::size_t>(nl - base) + 1 : end_;
+            begin_ = scan_ = upto;
+            if (!nl) return false;
+            discarding_ = false;
+            ++dropped_;
+            continue;
+        }
+
+        if (!nl) {
+            scan_ = end_;
+            if (end_ - begin_ > max_line_) {
+                discarding_ = true;
+                begin_ = scan_ = end_;
+            }
+            return false;
+        }
+
+        const std::size_t at = static_cast<std::size_t>(nl - base);
+        const std::size_t len = at - begin_;
+        const std::size_t start = begin_;
+        begin_ = scan_ = at + 1;
+        if (len > max_line_) {
+            ++dropped_;
+            continue;
+        }
+
+        line = std::string_view(base + start, len);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return true;
+    }
+}
+
+std::string_view lineFramer::peek() const
+{
+    if (discarding_) return {};
+    return std::string_view(buf_.data() + begin_, end_ - begin_);
+}
+
+void lineFramer::consume(std::size_t n)
+{
+    begin_ += n;
+    if (scan_ < begin_) scan_ = begin_;
+}
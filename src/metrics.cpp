@@ -0,0 +1,302 @@
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+#include "metrics.hpp"
+
+namespace {
+    constexpr int counters = static_cast<int>(metrics::counter::count);
+    using totals = std::array<std::uint64_t, counters>;
+
+    struct exposed {
+        std::string name, help;
+        metrics::kind k;
+        std::function<double()> read;
+    };
+
+#ifdef MSG_NOSIGNAL
+    constexpr int send_flags = MSG_NOSIGNAL;  // a scraper hanging up is no SIGPIPE
+#else
+    constexpr int send_flags = 0;
+#endif
+
+    std::mutex registry_lock;
+    std::unordered_set<const metrics::connection*> open_connections;
+    std::map<std::string, totals> closed;  // by stream
+    std::vector<exposed> values;
+    unsigned long next_id = 0;
+
+    const char* name(metrics::counter c) {
+        switch (c) {
+        case metrics::counter::bytes: return "bytes_received_total";
+        case metrics::counter::lines: return "lines_total";
+        case metrics::counter::frames: return "frames_total";
+        case metrics::counter::samples: return "samples_total";
+        case metrics::counter::parse_errors: return "parse_errors_total";
+        case metrics::counter::hops: return "denoiser_hops_total";
+        case metrics::counter::denoised: return "denoised_samples_total";
+        case metrics::counter::grid_gaps: return "resampler_gaps_total";
+        case metrics::counter::grid_dropped: return "resampler_dropped_samples_total";
+        case metrics::counter::count: break;
+        }
+        return "?";
+    }
+
+    const char* help(metrics::counter c) {
+        switch (c) {
+        case metrics::counter::bytes: return "Bytes read from clients.";
+        case metrics::counter::lines: return "Non-empty NDJSON lines received.";
+        case metrics::counter::frames: return "Binary frames received.";
+        case metrics::counter::samples: return "Samples parsed.";
+        case metrics::counter::parse_errors: return "Lines or frames that did not parse.";
+        case metrics::counter::hops: return "Denoiser hops emitted.";
+        case metrics::counter::denoised: return "Denoised samples emitted.";
+        case metrics::counter::grid_gaps: return "Gaps the resampler restarted its grid after.";
+        case metrics::counter::grid_dropped: return "Samples the resampler dropped for a time not after the last.";
+        case metrics::counter::count: break;
+        }
+        return "";
+    }
+
+    void header(std::string& out, const char* family, const char* help, const char* type) {
+        out += "# HELP ";
+        out += family;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += family;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void number(std::string& out, double v) {
+        char buf[32];
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+        out += '\n';
+    }
+
+    void number(std::string& out, std::uint64_t v) {
+        char buf[24];
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+        out += '\n';
+    }
+
+    // Writes all of [p, p + n) to a blocking socket
+    bool send_all(int fd, const char* p, std::size_t n) {
+        while (n > 0) {
+            const ssize_t k = ::send(fd, p, n, send_flags);
+            if (k < 0 && errno == EINTR) continue;
+            if (k <= 0) return false;
+            p += k;
+            n -= static_cast<std::size_t>(k);
+        }
+        return true;
+    }
+}
+
+namespace metrics {
+
+connection::connection(const char* stream) : stream_(stream)
+{
+    std::lock_guard<std::mutex> g(registry_lock);
+    id_ = next_id++;
+    open_connections.insert(this);
+}
+
+connection::~connection()
+{
+    std::lock_guard<std::mutex> g(registry_lock);
+    totals& t = closed[stream_];
+    for (int c = 0; c < counters; ++c) t[c] += v_[c].load(std::memory_order_relaxed);
+    open_connections.erase(this);
+}
+
+void expose(const std::string& name, const std::string& help, kind k, std::function<double()> read)
+{
+    std::lock_guard<std::mutex> g(registry_lock);
+    values.push_back({name, help, k, std::move(read)});
+}
+
+std::string render(bool per_connection)
+{
+    std::lock_guard<std::mutex> g(registry_lock);
+
+    // closed connections' counts plus the open ones', by stream
+    std::map<std::string, totals> sum = closed;
+    std::map<std::string, std::uint64_t> live;
+    for (const connection* c : open_connections) {
+        totals& t = sum[c->stream()];
+        for (int k = 0; k < counters; ++k) t[k] += c->get(static_cast<counter>(k));
+        ++live[c->stream()];
+    }
+
+    std::string out;
+    out.reserve(4096);
+    for (int k = 0; k < counters; ++k) {
+        const std::string family = std::string("ingest_") + name(static_cast<counter>(k));
+        header(out, family.c_str(), help(static_cast<counter>(k)), "counter");
+        for (const auto& [stream, t] : sum) {
+            out += family + "{stream=\"" + stream + "\"} ";
+            number(out, t[k]);
+        }
+    }
+    header(out, "ingest_connections", "Open connections (UDP: active senders).", "gauge");
+    for (const auto& [stream, t] : sum) {
+        const auto it = live.find(stream);
+        out += "ingest_connections{stream=\"" + stream + "\"} ";
+        number(out, it == live.end() ? std::uint64_t(0) : it->second);
+    }
+
+    for (const exposed& v : values) {
+        header(out, v.name.c_str(), v.help.c_str(), v.k == kind::counter ? "counter" : "gauge");
+        out += v.name + ' ';
+        number(out, v.read());
+    }
+
+    if (!per_connection) return out;
+
+    // ordered by id, so successive scrapes line up
+    std::map<unsigned long, const connection*> by_id;
+    for (const connection* c : open_connections) by_id[c->id()] = c;
+    for (int k = 0; k < counters; ++k) {
+        const std::string family = std::string("ingest_connection_") + name(static_cast<counter>(k));
+        header(out, family.c_str(), help(static_cast<counter>(k)), "counter");
+        for (const auto& [id, c] : by_id) {
+            out += family + "{stream=\"" + c->stream() + "\",conn=\"" + std::to_string(id) + "\"} ";
+            number(out, c->get(static_cast<counter>(k)));
+        }
+    }
+    return out;
+}
+
+bool endpoint::start(const std::string& where)
+{
+    const bool tcp = !where.empty() && where.find_first_not_of("0123456789") == std::string::npos;
+    fd_ = ::socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        std::perror("socket");
+        return false;
+    }
+
+    int rc;
+    if (tcp) {
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<std::uint16_t>(std::strtoul(where.c_str(), nullptr, 10)));
+        rc = ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (where.size() >= sizeof(addr.sun_path)) {
+            std::fprintf(stderr, "%s: socket path too long\n", where.c_str());
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        std::memcpy(addr.sun_path, where.c_str(), where.size() + 1);
+        struct stat st;
+        // a socket left over from an earlier run, but never any other file
+        if (::stat(where.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) ::unlink(where.c_str());
+        rc = ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (rc == 0) unix_path_ = where;
+    }
+    if (rc != 0 || ::listen(fd_, 16) != 0) {
+        std::perror(where.c_str());
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    stop_.store(false);
+    th_ = std::thread([this] { run_(); });
+    return true;
+}
+
+void endpoint::stop()
+{
+    stop_.store(true);
+    if (th_.joinable()) th_.join();
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    if (!unix_path_.empty()) ::unlink(unix_path_.c_str());
+    unix_path_.clear();
+}
+
+void endpoint::run_()
+{
+    while (!stop_.load()) {
+        // short timeout instead of a wake fd: stop() may wait this long
+        pollfd p{fd_, POLLIN, 0};
+        const int r = ::poll(&p, 1, 200);
+        if (r < 0 && errno != EINTR) {
+            std::perror("poll");
+            return;
+        }
+        if (r <= 0) continue;
+
+        const int c = ::accept(fd_, nullptr, nullptr);
+        if (c < 0) continue;
+        serve_(c);
+        ::close(c);
+    }
+}
+
+void endpoint::serve_(int fd) const
+{
+    // a scraper that never finishes its request cannot hold us up for long
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char req[4096];
+    std::size_t n = 0;
+    while (n < sizeof(req) - 1) {
+        const ssize_t k = ::recv(fd, req + n, sizeof(req) - 1 - n, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return;
+        n += static_cast<std::size_t>(k);
+        req[n] = '\0';
+        if (std::strstr(req, "\r\n\r\n") || std::strstr(req, "\n\n")) break;
+    }
+    req[n] = '\0';
+
+    // request line: GET <path>[?query] HTTP/1.x
+    std::string path;
+    if (std::strncmp(req, "GET ", 4) == 0) {
+        const char* p = req + 4;
+        const char* end = p + std::strcspn(p, " ?\r\n");
+        path.assign(p, end);
+    }
+
+    std::string body, status = "200 OK";
+    if (path == "/metrics" || path == "/") {
+        body = render(false);
+    } else if (path == "/metrics/connections") {
+        body = render(true);
+    } else {
+        status = "404 Not Found";
+        body = "try /metrics or /metrics/connections\n";
+    }
+
+    const std::string head = "HTTP/1.1 " + status +
+                             "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8"
+                             "\r\nContent-Length: " + std::to_string(body.size()) +
+                             "\r\nConnection: close\r\n\r\n";
+    if (send_all(fd, head.data(), head.size())) send_all(fd, body.data(), body.size());
+}
+
+} // namespace metrics
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/sock_diag.h>
+#endif
+#include "ingestServer.hpp"
+#include "outputFanout.hpp"
+
+namespace {
+#ifdef MSG_NOSIGNAL
+    constexpr int send_flags = MSG_NOSIGNAL | MSG_DONTWAIT;  // a consumer hanging up is no SIGPIPE
+#else
+    constexpr int send_flags = MSG_DONTWAIT;
+#endif
+
+    // room for a few output bursts while a consumer catches up; the kernel
+    // caps it at net.core.wmem_max, so fits_() asks for the size it got
+    constexpr int consumer_sndbuf = 4 << 20;
+
+    // How long a consumer may take to make room for a group of batches, or
+    // to read into a batch larger than its whole socket buffer. The writer
+    // drains a backlog far faster than anyone reads.
+    constexpr int consumer_wait_ms = 100;
+}
+
+bool outputFanout::start(const std::string& where)
+{
+    listenAddress tcp{"127.0.0.1", 0};
+    const bool is_tcp = tcp.parse(where.c_str());
+    fd_ = ::socket(is_tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        std::perror("socket");
+        return false;
+    }
+
+    int rc;
+    if (is_tcp) {
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr;
+        if (!tcp.resolve(addr)) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        rc = ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (where.size() >= sizeof(addr.sun_path)) {
+            std::fprintf(stderr, "%s: socket path too long\n", where.c_str());
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        std::memcpy(addr.sun_path, where.c_str(), where.size() + 1);
+        struct stat st;
+        // a socket left over from an earlier run, but never any other file
+        if (::stat(where.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) ::unlink(where.c_str());
+        rc = ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (rc == 0) unix_path_ = where;
+    }
+    if (rc != 0 || ::listen(fd_, 16) != 0) {
+        std::perror(where.c_str());
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    stop_.store(false);
+    th_ = std::thread([this] { run_(); });
+    return true;
+}
+
+void outputFanout::stop()
+{
+    stop_.store(true);
+    if (th_.joinable()) th_.join();
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    if (!unix_path_.empty()) ::unlink(unix_path_.c_str());
+    unix_path_.clear();
+
+    std::lock_guard<std::mutex> g(lock_);
+    for (int c : consumers_) ::close(c);
+    consumers_.clear();
+}
+
+std::size_t outputFanout::consumers() const
+{
+    std::lock_guard<std::mutex> g(lock_);
+    return consumers_.size();
+}
+
+void outputFanout::run_()
+{
+    while (!stop_.load()) {
+        // short timeout instead of a wake fd: stop() may wait this long
+        pollfd p{fd_, POLLIN, 0};
+        const int r = ::poll(&p, 1, 200);
+        if (r < 0 && errno != EINTR) {
+            std::perror("poll");
+            return;
+        }
+        if (r <= 0) continue;
+
+        const int c = ::accept(fd_, nullptr, nullptr);
+        if (c < 0) continue;
+        ::setsockopt(c, SOL_SOCKET, SO_SNDBUF, &consumer_sndbuf, sizeof(consumer_sndbuf));
+        // consumers only read; anything they send is never looked at
+        ::shutdown(c, SHUT_RD);
+
+        std::lock_guard<std::mutex> g(lock_);
+        consumers_.push_back(c);
+        std::fprintf(stderr, "consumer attached (%zu)\n", consumers_.size());
+    }
+}
+
+void outputFanout::send(const asyncWriter::span* pieces, int count)
+{
+    std::lock_guard<std::mutex> g(lock_);
+    std::size_t total = 0;
+    for (int k = 0; k < count; ++k) total += pieces[k].n;
+
+    for (std::size_t i = 0; i < consumers_.size();) {
+        const int c = consumers_[i];
+        bool ok = room_(c, total), gone = false;
+        for (int k = 0; ok && k < count; ++k) ok = send_all_(c, pieces[k].p, pieces[k].n, gone);
+        if (ok) {
+            ++i;
+            continue;
+        }
+        if (!gone) slow_.fetch_add(1, std::memory_order_relaxed);
+        ::close(c);
+        consumers_[i] = consumers_.back();
+        consumers_.pop_back();
+        std::fprintf(stderr, "consumer %s (%zu left)\n", gone ? "detached" : "too slow, disconnected",
+                     consumers_.size());
+    }
+}
+
+bool outputFanout::room_(int fd, std::size_t n)
+{
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(consumer_wait_ms);
+    while (!fits_(fd, n)) {
+        if (std::chrono::steady_clock::now() >= until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool outputFanout::fits_(int fd, std::size_t n)
+{
+#ifdef SO_MEMINFO
+    // Buffer use as the kernel counts it against SO_SNDBUF: queued payload
+    // plus its buffer overhead (TCP), or buffers allocated (Unix sockets).
+    // The new bytes are given a quarter and a page on top for theirs. A
+    // batch larger than the whole buffer still goes to a consumer that has
+    // taken everything so far, with send_all_() waiting for it to read.
+    std::uint32_t mem[SK_MEMINFO_VARS] = {};
+    socklen_t len = sizeof(mem);
+    if (::getsockopt(fd, SOL_SOCKET, SO_MEMINFO, mem, &len) == 0) {
+        const std::size_t used = std::max(mem[SK_MEMINFO_WMEM_QUEUED], mem[SK_MEMINFO_WMEM_ALLOC]);
+        return used == 0 || used + n + n / 4 + 4096 <= mem[SK_MEMINFO_SNDBUF];
+    }
+#endif
+    (void)fd;
+    (void)n;
+    return true;  // no way to tell: send and see
+}
+
+bool outputFanout::send_all_(int fd, const char* p, std::size_t n, bool& gone)
+{
+    while (n > 0) {
+        const ssize_t k = ::send(fd, p, n, send_flags);
+        if (k < 0 && errno == EINTR) continue;
+        if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // only a batch larger than the buffer gets here when fits_()
+            // could tell; give the consumer a moment to read some of it
+            pollfd w{fd, POLLOUT, 0};
+            if (::poll(&w, 1, consumer_wait_ms) == 1 && (w.revents & POLLOUT)) continue;
+            return false;
+        }
+        if (k < 0) {
+            gone = true;
+            return false;
+        }
+        p += k;
+        n -= static_cast<std::size_t>(k);
+    }
+    return true;
+}
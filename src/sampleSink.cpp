@@ -0,0 +1,181 @@
+#include <charconv>
+#include <cstring>
+#include "sampleSink.hpp"
+
+namespace {
+    // A batch is handed over early once it is this large
+    constexpr std::size_t batch_limit = 64 * 1024;
+
+    char* put(char* p, const char* s) {
+        const std::size_t n = std::strlen(s);
+        std::memcpy(p, s, n);
+        return p + n;
+    }
+    // As std::ostream prints a double by default (%g, 6 digits)
+    char* put_g(char* p, double v) {
+        return std::to_chars(p, p + 32, v, std::chars_format::general, 6).ptr;
+    }
+    // Shortest digits that read back to the same double
+    char* put_exact(char* p, double v) {
+        return std::to_chars(p, p + 32, v).ptr;
+    }
+}
+
+bool parse_sink_format(const char* name, sinkFormat& f)
+{
+    if (std::strcmp(name, "text") == 0) f = sinkFormat::text;
+    else if (std::strcmp(name, "csv") == 0) f = sinkFormat::csv;
+    else if (std::strcmp(name, "binary") == 0) f = sinkFormat::binary;
+    else return false;
+    return true;
+}
+
+formatSink::formatSink(asyncWriter* out, sinkFormat f) : out_(out), format_(f)
+{
+    if (out_) batch_.reserve(batch_limit + 1024);
+}
+
+void formatSink::imu(const IMUsample& s)
+{
+    if (!out_) return;
+    const double* q = s.getQuat();
+    const double* a = s.getAccG();
+    if (format_ != sinkFormat::text) {
+        const double v[8] = {s.getTimestamp(), q[0], q[1], q[2], q[3], a[0], a[1], a[2]};
+        record_(1, "imu", v, 8);
+        return;
+    }
+
+    char buf[256];
+    char* p = put(buf, "Parsed IMUsample:\n  t    = ");
+    p = put_g(p, s.getTimestamp());
+    p = put(p, "\n  quat = [");
+    for (int k = 0; k < 4; ++k) {
+        if (k) p = put(p, ", ");
+        p = put_g(p, q[k]);
+    }
+    p = put(p, "]\n  acc_g= [");
+    for (int k = 0; k < 3; ++k) {
+        if (k) p = put(p, ", ");
+        p = put_g(p, a[k]);
+    }
+    p = put(p, "]\n");
+    commit_(buf, static_cast<std::size_t>(p - buf));
+}
+
+void formatSink::denoised(double t, double x, double y, double z)
+{
+    if (!out_) return;
+    if (format_ != sinkFormat::text) {
+        const double v[4] = {t, x, y, z};
+        record_(2, "den", v, 4);
+        return;
+    }
+
+    char buf[128];
+    char* p = put_g(buf, x);
+    *p++ = ' ';
+    p = put_g(p, y);
+    *p++ = ' ';
+    p = put_g(p, z);
+    *p++ = '\n';
+    commit_(buf, static_cast<std::size_t>(p - buf));
+}
+
+void formatSink::gps(const GPSsample& s)
+{
+    if (!out_) return;
+    if (format_ != sinkFormat::text) {
+        const double v[9] = {s.getTime(), s.getLatitude(), s.getLongitude(), s.getAltitude(),
+                             s.getHAcc(), s.getVAcc(), s.getSpeed(), s.getCourse(), s.getTGPS()};
+        record_(3, "gps", v, 9);
+        return;
+    }
+
+    char buf[384];
+    char* p = put(buf, "GPS data: t: ");
+    p = put_g(p, s.getTime());
+    p = put(p, "\nLatitude: ");
+    p = put_g(p, s.getLatitude());
+    p = put(p, " Longitude: ");
+    p = put_g(p, s.getLongitude());
+    p = put(p, " Altitude: ");
+    p = put_g(p, s.getAltitude());
+    p = put(p, "\nhAcc: ");
+    p = put_g(p, s.getHAcc());
+    p = put(p, " vAcc: ");
+    p = put_g(p, s.getVAcc());
+    p = put(p, " speed: ");
+    p = put_g(p, s.getSpeed());
+    p = put(p, " t_gps: ");
+    p = put_g(p, s.getTGPS());
+    p = put(p, "\n");
+    commit_(buf, static_cast<std::size_t>(p - buf));
+}
+
+void formatSink::joined(const streamJoin::joined& j)
+{
+    if (!out_) return;
+    const int fix = !j.has_fix ? 0 : j.interpolated ? 2 : 1;
+    if (format_ != sinkFormat::text) {
+        const double v[10] = {j.imu.getTimestamp(), j.t_gps, double(fix), j.lat, j.lon, j.alt,
+                              j.hAcc, j.vAcc, j.speed, j.course};
+        record_(4, "join", v, 10);
+        return;
+    }
+
+    char buf[384];
+    char* p = put(buf, "Joined: t: ");
+    p = put_g(p, j.imu.getTimestamp());
+    p = put(p, " t_gps: ");
+    p = put_g(p, j.t_gps);
+    if (fix == 0) {
+        p = put(p, " no fix\n");
+        commit_(buf, static_cast<std::size_t>(p - buf));
+        return;
+    }
+    p = put(p, fix == 2 ? " interpolated\nLatitude: " : " dead-reckoned\nLatitude: ");
+    p = put_g(p, j.lat);
+    p = put(p, " Longitude: ");
+    p = put_g(p, j.lon);
+    p = put(p, " Altitude: ");
+    p = put_g(p, j.alt);
+    p = put(p, " speed: ");
+    p = put_g(p, j.speed);
+    p = put(p, " course: ");
+    p = put_g(p, j.course);
+    p = put(p, "\n");
+    commit_(buf, static_cast<std::size_t>(p - buf));
+}
+
+void formatSink::flush()
+{
+    if (batch_.empty()) return;
+    out_->write(batch_.data(), batch_.size());
+    batch_.clear();
+}
+
+void formatSink::record_(char tag, const char* csv_name, const double* v, int n)
+{
+    char buf[512];
+    char* p = buf;
+    if (format_ == sinkFormat::csv) {
+        p = put(p, csv_name);
+        for (int k = 0; k < n; ++k) {
+            *p++ = ',';
+            p = put_exact(p, v[k]);
+        }
+        *p++ = '\n';
+    } else {
+        *p++ = tag;
+        std::memcpy(p, v, static_cast<std::size_t>(n) * sizeof(double));
+        p += n * sizeof(double);
+    }
+    commit_(buf, static_cast<std::size_t>(p - buf));
+}
+
+void formatSink::commit_(const char* p, std::size_t n)
+{
+    batch_.append(p, n);
+    if (batch_.size() >= batch_limit) flush();
+}
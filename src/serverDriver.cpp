@@ -0,0 +1,190 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include "latency.hpp"
+#include "serverDriver.hpp"
+#include "udpServer.hpp"
+
+namespace {
+    ingestServer* running_server = nullptr;
+    udpServer* running_udp = nullptr;
+
+    void on_signal(int) {
+        if (running_server) running_server->stop();
+        if (running_udp) running_udp->stop();
+    }
+
+    void on_report(int) {
+        latency::request_report();
+    }
+
+    // "rate", "rate:linear" or "rate:cubic"
+    bool parse_grid(const char* arg, resampler::options& o)
+    {
+        char* end;
+        o.rate = strtod(arg, &end);
+        if (!(o.rate > 0)) return false;
+        if (*end == '\0' || strcmp(end, ":linear") == 0) o.how = resampler::method::linear;
+        else if (strcmp(end, ":cubic") == 0) o.how = resampler::method::cubic;
+        else return false;
+        return true;
+    }
+
+    // Multi-client mode: every connection gets its own session
+    int serve_many(const driver::options& opt, const ingestServer::factory& make)
+    {
+        ingestServer server(opt.listen.port, make, opt.threads);
+        server.set_host(opt.listen.host);
+        server.set_reuseport(opt.reuseport);
+        server.set_pin_cpus(opt.pin);
+        if (!server.start()) return 1;
+
+        running_server = &server;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        fprintf(opt.notices, "Server listening on %s with %d thread(s)%s..\n", opt.listen.str().c_str(),
+                opt.threads, opt.reuseport ? ", one listener each" : "");
+        fflush(opt.notices);
+        server.run();
+        running_server = nullptr;
+        return 0;
+    }
+
+    // UDP mode: every sender address gets its own session
+    int serve_udp(const driver::options& opt, const ingestServer::factory& make)
+    {
+        udpServer server(opt.listen.port, make);
+        server.set_host(opt.listen.host);
+        if (!server.start()) return 1;
+
+        running_udp = &server;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        fprintf(opt.notices, "Server receiving datagrams on %s..\n", opt.listen.str().c_str());
+        fflush(opt.notices);
+        server.run();
+        running_udp = nullptr;
+
+        const udpServer::stats t = server.totals();
+        fprintf(stderr,
+                "datagrams %llu, frames %llu (%llu samples), reordered %llu, lost frames %llu, "
+                "late samples %llu, dropped samples %llu, bad %llu\n",
+                (unsigned long long)t.datagrams, (unsigned long long)t.frames,
+                (unsigned long long)t.samples, (unsigned long long)t.reordered,
+                (unsigned long long)t.lost_frames, (unsigned long long)t.late_samples,
+                (unsigned long long)t.dropped_samples, (unsigned long long)t.bad);
+        return 0;
+    }
+}
+
+namespace driver {
+
+arg parse(int argc, char** argv, int& i, options& opt)
+{
+    const char* a = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (strcmp(a, "-m") == 0) {
+        opt.many = true;
+        if (has_value && argv[i + 1][0] != '-') opt.threads = atoi(argv[++i]);
+    } else if (strcmp(a, "-r") == 0) {
+        opt.reuseport = true;
+    } else if (strcmp(a, "-c") == 0) {
+        opt.pin = true;
+    } else if (strcmp(a, "-q") == 0) {
+        opt.quiet = true;
+    } else if (strcmp(a, "-u") == 0) {
+        opt.udp = true;
+    } else if (strcmp(a, "-w") == 0 && has_value) {
+        opt.record = argv[++i];
+    } else if (strcmp(a, "-o") == 0 && has_value && parse_sink_format(argv[i + 1], opt.format)) {
+        ++i;
+    } else if (strcmp(a, "-d") == 0) {
+        opt.drop = true;
+    } else if (strcmp(a, "-p") == 0 && has_value) {
+        if (!opt.listen.parse(argv[++i])) {
+            fprintf(stderr, "-p: [host:]port\n");
+            return arg::bad;
+        }
+    } else if (strcmp(a, "-M") == 0 && has_value) {
+        opt.metrics = argv[++i];
+    } else if (strcmp(a, "-l") == 0) {
+        opt.latency = 0;
+        if (has_value && argv[i + 1][0] != '-') opt.latency = atoi(argv[++i]);
+    } else {
+        return arg::other;
+    }
+    return arg::taken;
+}
+
+arg parse(int argc, char** argv, int& i, IMU::pipeline& stages)
+{
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+        resampler::options grid;
+        if (!parse_grid(argv[++i], grid)) {
+            fprintf(stderr, "-s: rate[:linear|:cubic], rate > 0\n");
+            return arg::bad;
+        }
+        stages.grid = grid;
+    } else if (strcmp(argv[i], "-g") == 0) {
+        stages.world = worldFrame::options();
+    } else {
+        return arg::other;
+    }
+    return arg::taken;
+}
+
+bool check(options& opt)
+{
+    if (opt.udp && opt.many) {
+        fprintf(stderr, "-u and -m exclude each other\n");
+        return false;
+    }
+    if (opt.threads < 1) opt.threads = 1;
+    if (opt.latency >= 0 && !latency::enabled) {
+        fprintf(stderr, "-l: built without IMU_LATENCY\n");
+        opt.latency = -1;
+    }
+    if (opt.latency >= 0) {
+        std::signal(SIGUSR1, on_report);
+        latency::start_reporter(opt.latency);
+    }
+    return true;
+}
+
+int serve(const options& opt, const ingestServer::factory& make, asyncWriter& out)
+{
+    const int rc = opt.udp ? serve_udp(opt, make) : serve_many(opt, make);
+    out.flush();
+    report(opt, out);
+    return rc;
+}
+
+bool serve_metrics(const char* where, const asyncWriter& out, metrics::endpoint& ep)
+{
+    metrics::expose("ingest_output_buffered_bytes", "Output queued for stdout, not yet written.",
+                    metrics::kind::gauge, [&out] { return double(out.buffered_bytes()); });
+    metrics::expose("ingest_output_buffer_capacity_bytes", "Size of the output buffer.",
+                    metrics::kind::gauge, [&out] { return double(out.capacity()); });
+    metrics::expose("ingest_output_written_bytes_total", "Output written to stdout.",
+                    metrics::kind::counter, [&out] { return double(out.written_bytes()); });
+    metrics::expose("ingest_output_dropped_bytes_total", "Output dropped with -d.",
+                    metrics::kind::counter, [&out] { return double(out.dropped_bytes()); });
+    if (!ep.start(where)) return false;
+    if (strspn(where, "0123456789") == strlen(where)) {
+        fprintf(stderr, "metrics on http://127.0.0.1:%s/metrics\n", where);
+    } else {
+        fprintf(stderr, "metrics on Unix socket %s\n", where);
+    }
+    return true;
+}
+
+void report(const options& opt, const asyncWriter& out)
+{
+    if (out.dropped_batches() > 0) {
+        fprintf(stderr, "output dropped: %llu bursts, %llu bytes\n",
+                (unsigned long long)out.dropped_batches(), (unsigned long long)out.dropped_bytes());
+    }
+    if (opt.latency >= 0) latency::report(stderr);
+}
+
+} // namespace driver
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sessionFile.hpp"
+
+namespace {
+    constexpr char file_magic[8] = {'I', 'M', 'U', 'R', 'E', 'C', '1', '\0'};
+    constexpr std::uint32_t file_version = 1;
+    // written in host order; a reader on another byte order sees it swapped
+    constexpr std::uint32_t order_mark = 0x01020304;
+    constexpr char chunk_magic[4] = {'C', 'H', 'K', '1'};
+
+    constexpr std::size_t page = 4096;
+    constexpr std::size_t header_bytes = page;
+    constexpr std::size_t chunk_header = 64;
+    constexpr int max_columns = 9;
+    constexpr std::size_t chunk_bytes =
+        (chunk_header + max_columns * sizeof(double) * rec::chunk_rows + page - 1) / page * page;
+    // The file grows this many chunks at a time
+    constexpr std::uint64_t segment_chunks = 16;
+
+    struct file_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t order;
+        std::uint64_t chunk_rows;
+        std::uint64_t chunk_bytes;
+    };
+
+    // chunk header fields
+    constexpr std::size_t at_stream = 4;
+    constexpr std::size_t at_rows = 8;
+    constexpr std::size_t at_first_t = 16;
+    constexpr std::size_t at_last_t = 24;
+
+    off_t chunk_offset(std::uint64_t k) {
+        return static_cast<off_t>(header_bytes + k * chunk_bytes);
+    }
+
+    double* column(char* base, int c) {
+        return reinterpret_cast<double*>(base + chunk_header + c * rec::chunk_rows * sizeof(double));
+    }
+    const double* column(const char* base, int c) {
+        return reinterpret_cast<const double*>(base + chunk_header + c * rec::chunk_rows * sizeof(double));
+    }
+
+    template <typename T>
+    T load(const char* p) {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        return v;
+    }
+    template <typename T>
+    void store(char* p, T v) {
+        std::memcpy(p, &v, sizeof(T));
+    }
+}
+
+namespace rec {
+
+int columns(stream s)
+{
+    switch (s) {
+    case stream::imu: return 8;
+    case stream::denoised: return 4;
+    case stream::gps: return 9;
+    }
+    return 0;
+}
+
+} // namespace rec
+
+// -------- sessionRecorder --------
+
+bool sessionRecorder::open(const std::string& path)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::perror(path.c_str());
+        return false;
+    }
+
+    char page_buf[header_bytes] = {};
+    file_header h{};
+    std::memcpy(h.magic, file_magic, sizeof(h.magic));
+    h.version = file_version;
+    h.order = order_mark;
+    h.chunk_rows = rec::chunk_rows;
+    h.chunk_bytes = chunk_bytes;
+    std::memcpy(page_buf, &h, sizeof(h));
+    if (::pwrite(fd_, page_buf, sizeof(page_buf), 0) != static_cast<ssize_t>(sizeof(page_buf))) {
+        std::perror("write");
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    chunks_ = reserved_ = 0;
+    failed_ = false;
+    for (auto& r : rows_) r = 0;
+    return true;
+}
+
+void sessionRecorder::close()
+{
+    if (fd_ < 0) return;
+    for (auto& c : open_) seal_(c);
+    // drop the preallocated chunks that were never started
+    if (::ftruncate(fd_, chunk_offset(chunks_)) != 0) std::perror("ftruncate");
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void sessionRecorder::imu(const IMUsample& s)
+{
+    const double* q = s.getQuat();
+    const double* a = s.getAccG();
+    const double row[8] = {s.getTimestamp(), q[0], q[1], q[2], q[3], a[0], a[1], a[2]};
+    append_(rec::stream::imu, row);
+}
+
+void sessionRecorder::denoised(double t, double x, double y, double z)
+{
+    const double row[4] = {t, x, y, z};
+    append_(rec::stream::denoised, row);
+}
+
+void sessionRecorder::gps(const GPSsample& s)
+{
+    const double row[9] = {s.getTime(), s.getLatitude(), s.getLongitude(), s.getAltitude(),
+                           s.getHAcc(), s.getVAcc(), s.getSpeed(), s.getCourse(), s.getTGPS()};
+    append_(rec::stream::gps, row);
+}
+
+void sessionRecorder::append_(rec::stream s, const double* row)
+{
+    chunk& c = open_[index_(s)];
+    if (c.base == nullptr || c.rows == rec::chunk_rows) {
+        seal_(c);
+        if (failed_ || fd_ < 0 || !start_chunk_(s)) return;
+    }
+
+    const int n = rec::columns(s);
+    for (int k = 0; k < n; ++k) column(c.base, k)[c.rows] = row[k];
+    if (c.rows == 0) store(c.base + at_first_t, row[0]);
+    store(c.base + at_last_t, row[0]);
+    // last, so the row is complete before it is counted
+    store(c.base + at_rows, ++c.rows);
+    ++rows_[index_(s)];
+}
+
+bool sessionRecorder::start_chunk_(rec::stream s)
+{
+    if (chunks_ == reserved_) {
+        const off_t size = chunk_offset(reserved_ + segment_chunks);
+        int err = ::posix_fallocate(fd_, 0, size);
+        if (err == EOPNOTSUPP || err == EINVAL) err = ::ftruncate(fd_, size) == 0 ? 0 : errno;
+        if (err != 0) {
+            errno = err;
+            std::perror("fallocate");
+            failed_ = true;
+            return false;
+        }
+        reserved_ += segment_chunks;
+    }
+
+    void* p = ::mmap(nullptr, chunk_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, chunk_offset(chunks_));
+    if (p == MAP_FAILED) {
+        std::perror("mmap");
+        failed_ = true;
+        return false;
+    }
+    ++chunks_;
+
+    chunk& c = open_[index_(s)];
+    c.base = static_cast<char*>(p);
+    c.rows = 0;
+    std::memcpy(c.base, chunk_magic, sizeof(chunk_magic));
+    c.base[at_stream] = static_cast<char>(s);
+    return true;
+}
+
+void sessionRecorder::seal_(chunk& c)
+{
+    if (c.base == nullptr) return;
+    // the page cache has the data; it reaches the disk without an msync
+    ::munmap(c.base, chunk_bytes);
+    c.base = nullptr;
+    c.rows = 0;
+}
+
+// -------- sessionReader --------
+
+sessionReader::~sessionReader()
+{
+    if (map_) ::munmap(const_cast<char*>(map_), size_);
+}
+
+bool sessionReader::open(const std::string& path)
+{
+    if (map_) {
+        ::munmap(const_cast<char*>(map_), size_);
+        map_ = nullptr;
+    }
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror(path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < header_bytes) {
+        std::fprintf(stderr, "%s: not a session file\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::perror("mmap");
+        return false;
+    }
+    map_ = static_cast<const char*>(p);
+
+    const file_header h = load<file_header>(map_);
+    if (std::memcmp(h.magic, file_magic, sizeof(file_magic)) != 0 || h.version != file_version ||
+        h.order != order_mark || h.chunk_rows != rec::chunk_rows || h.chunk_bytes != chunk_bytes) {
+        std::fprintf(stderr, "%s: not a session file of this version and byte order\n", path.c_str());
+        return false;
+    }
+
+    // Build the time index from the chunk headers
+    for (auto& ix : streams_) ix = index{};
+    const std::uint64_t n = (size_ - header_bytes) / chunk_bytes;
+    for (std::uint64_t k = 0; k < n; ++k) {
+        const char* base = map_ + chunk_offset(k);
+        // preallocated and never used (a recorder that did not close)
+        if (std::memcmp(base, chunk_magic, sizeof(chunk_magic)) != 0) continue;
+        const int s = static_cast<unsigned char>(base[at_stream]);
+        const std::uint32_t rows = load<std::uint32_t>(base + at_rows);
+        if (s < 1 || s > rec::stream_count || rows == 0 || rows > rec::chunk_rows) continue;
+
+        index& ix = streams_[s - 1];
+        if (ix.first_row.empty()) ix.first_row.push_back(0);
+        ix.chunks.push_back(base);
+        ix.first_t.push_back(load<double>(base + at_first_t));
+        ix.first_row.push_back(ix.first_row.back() + rows);
+    }
+    return true;
+}
+
+std::uint64_t sessionReader::rows(rec::stream s) const
+{
+    const index& ix = index_(s);
+    return ix.first_row.empty() ? 0 : ix.first_row.back();
+}
+
+std::size_t sessionReader::locate_(const index& ix, std::uint64_t row, std::uint32_t& at) const
+{
+    const auto it = std::upper_bound(ix.first_row.begin(), ix.first_row.end(), row);
+    const std::size_t k = static_cast<std::size_t>(it - ix.first_row.begin()) - 1;
+    at = static_cast<std::uint32_t>(row - ix.first_row[k]);
+    return k;
+}
+
+double sessionReader::value(rec::stream s, std::uint64_t row, int c) const
+{
+    const index& ix = index_(s);
+    std::uint32_t at;
+    const std::size_t k = locate_(ix, row, at);
+    return column(ix.chunks[k], c)[at];
+}
+
+std::uint64_t sessionReader::seek(rec::stream s, double t) const
+{
+    const index& ix = index_(s);
+    if (ix.chunks.empty()) return 0;
+
+    // last chunk starting before t; the first row >= t is in it or starts the next
+    const auto it = std::lower_bound(ix.first_t.begin(), ix.first_t.end(), t);
+    if (it == ix.first_t.begin()) return 0;
+    const std::size_t k = static_cast<std::size_t>(it - ix.first_t.begin()) - 1;
+
+    const double* ts = column(ix.chunks[k], 0);
+    const std::uint64_t rows = ix.first_row[k + 1] - ix.first_row[k];
+    return ix.first_row[k] + static_cast<std::uint64_t>(std::lower_bound(ts, ts + rows, t) - ts);
+}
+
+IMUsample sessionReader::imu(std::uint64_t row) const
+{
+    const index& ix = index_(rec::stream::imu);
+    std::uint32_t at;
+    const char* base = ix.chunks[locate_(ix, row, at)];
+    double q[4], a[3];
+    for (int k = 0; k < 4; ++k) q[k] = column(base, 1 + k)[at];
+    for (int k = 0; k < 3; ++k) a[k] = column(base, 5 + k)[at];
+
+    IMUsample s;
+    s.setTimestamp(column(base, 0)[at]);
+    s.setQuat(q);
+    s.setAccG(a);
+    return s;
+}
+
+GPSsample sessionReader::gps(std::uint64_t row) const
+{
+    const index& ix = index_(rec::stream::gps);
+    std::uint32_t at;
+    const char* base = ix.chunks[locate_(ix, row, at)];
+    auto v = [&](int c) { return column(base, c)[at]; };
+
+    GPSsample g;
+    g.setTime(v(0));
+    g.setLatitude(v(1));
+    g.setLongitude(v(2));
+    g.setAltitude(v(3));
+    g.setHAcc(v(4));
+    g.setVAcc(v(5));
+    g.setSpeed(v(6));
+    g.setCourse(v(7));
+    g.setTGPS(v(8));
+    return g;
+}
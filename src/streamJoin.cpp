@@ -0,0 +1,174 @@
+#include <cmath>
+#include "streamJoin.hpp"
+
+namespace {
+    constexpr double deg = M_PI / 180.0;
+    constexpr double earth_radius = 6371000.0;   // m, mean; only for dead reckoning
+
+    bool motion_valid(const GPSsample& g) { return g.getSpeed() >= 0.0 && g.getCourse() >= 0.0; }
+
+    double lerp(double a, double b, double u) { return a + u * (b - a); }
+
+    // Shortest-way interpolation of angles in degrees, result in [0, 360)
+    double lerp_deg(double a, double b, double u)
+    {
+        double d = std::fmod(b - a, 360.0);
+        if (d > 180.0) d -= 360.0;
+        if (d < -180.0) d += 360.0;
+        const double r = std::fmod(a + u * d, 360.0);
+        return r < 0.0 ? r + 360.0 : r;
+    }
+
+    void copy(const GPSsample& g, streamJoin::joined& out)
+    {
+        out.lat = g.getLatitude();
+        out.lon = g.getLongitude();
+        out.alt = g.getAltitude();
+        out.hAcc = g.getHAcc();
+        out.vAcc = g.getVAcc();
+        out.speed = g.getSpeed();
+        out.course = g.getCourse();
+    }
+}
+
+void streamJoin::imu(const IMUsample& s)
+{
+    const double t = s.getTimestamp();
+    if (!(t > released_)) {
+        ++late_imu_;
+        return;
+    }
+    if (n_ == capacity) {
+        // only when the caller did not drain: nowhere to put it
+        ++late_imu_;
+        return;
+    }
+
+    // slot in by time; in-order samples stop at once
+    unsigned i = n_;
+    for (; i > 0 && at_(i - 1).getTimestamp() > t; --i) at_(i) = at_(i - 1);
+    at_(i) = s;
+    ++n_;
+    if (t > imu_max_) imu_max_ = t;
+}
+
+void streamJoin::gps(const GPSsample& g)
+{
+    double t = g.getTime();
+    if (std::isfinite(g.getTGPS()) && g.getTGPS() > 0.0) {
+        fit_(g.getTime(), g.getTGPS());
+        t = to_phone(g.getTGPS());
+    }
+
+    if (nfix_ == static_cast<int>(fixes_.size())) {
+        if (t < fixes_[0].t) {
+            ++late_gps_;
+            return;
+        }
+        for (int i = 1; i < nfix_; ++i) fixes_[i - 1] = fixes_[i];
+        --nfix_;
+    }
+    int i = nfix_;
+    for (; i > 0 && fixes_[i - 1].t > t; --i) fixes_[i] = fixes_[i - 1];
+    fixes_[i] = {t, g};
+    ++nfix_;
+}
+
+void streamJoin::fit_(double t, double t_gps)
+{
+    if (!fitted_) {
+        t_ref_ = t;
+        fitted_ = true;
+    }
+    const double x = t - t_ref_;
+    const double y = t_gps - t;
+    const double f = opt_.forget;
+    sw_ = f * sw_ + 1.0;
+    sx_ = f * sx_ + x;
+    sy_ = f * sy_ + y;
+    sxx_ = f * sxx_ + x * x;
+    sxy_ = f * sxy_ + x * y;
+
+    // weighted least squares y = intercept + drift * x; with the fixes
+    // too close together for a slope, the weighted mean offset
+    const double det = sw_ * sxx_ - sx_ * sx_;
+    if (det > 1e-9 * sw_ * sw_) {
+        drift_ = (sw_ * sxy_ - sx_ * sy_) / det;
+        intercept_ = (sy_ - drift_ * sx_) / sw_;
+    } else {
+        drift_ = 0.0;
+        intercept_ = sy_ / sw_;
+    }
+    offset_ = intercept_ + drift_ * x;
+}
+
+bool streamJoin::next(joined& out)
+{
+    if (n_ == 0) {
+        flushing_ = false;
+        return false;
+    }
+    const IMUsample& s = at_(0);
+    const double t = s.getTimestamp();
+    const bool bracketed = nfix_ > 0 && fixes_[nfix_ - 1].t >= t && t <= watermark();
+    if (!(flushing_ || n_ == capacity || bracketed || t <= imu_max_ - opt_.max_wait)) return false;
+
+    out.imu = s;
+    annotate_(t, out);
+    released_ = t;
+    head_ = (head_ + 1) & (capacity - 1);
+    --n_;
+    return true;
+}
+
+void streamJoin::annotate_(double t, joined& out) const
+{
+    out.t_gps = to_gps(t);
+    out.has_fix = nfix_ > 0;
+    out.interpolated = false;
+    if (!out.has_fix) {
+        out.lat = out.lon = out.alt = out.hAcc = out.vAcc = 0.0;
+        out.speed = out.course = -1.0;
+        return;
+    }
+
+    // fixes_[b] is the first at or after t
+    int b = 0;
+    while (b < nfix_ && fixes_[b].t < t) ++b;
+
+    if (b == 0) {
+        // before every fix kept: hold the first
+        copy(fixes_[0].g, out);
+        out.interpolated = fixes_[0].t == t;
+        return;
+    }
+    const fix& fa = fixes_[b - 1];
+    if (b == nfix_) {
+        // past the last fix: carry it forward along its course
+        copy(fa.g, out);
+        if (motion_valid(fa.g)) {
+            const double d = fa.g.getSpeed() * (t - fa.t) / earth_radius;
+            const double c = fa.g.getCourse() * deg;
+            out.lat += d * std::cos(c) / deg;
+            out.lon += d * std::sin(c) / (std::cos(fa.g.getLatitude() * deg) * deg);
+        }
+        return;
+    }
+
+    const fix& fb = fixes_[b];
+    const double u = fb.t > fa.t ? (t - fa.t) / (fb.t - fa.t) : 1.0;
+    double dlon = fb.g.getLongitude() - fa.g.getLongitude();
+    if (dlon > 180.0) dlon -= 360.0;
+    if (dlon < -180.0) dlon += 360.0;
+    out.lat = lerp(fa.g.getLatitude(), fb.g.getLatitude(), u);
+    out.lon = fa.g.getLongitude() + u * dlon;
+    if (out.lon > 180.0) out.lon -= 360.0;
+    if (out.lon < -180.0) out.lon += 360.0;
+    out.alt = lerp(fa.g.getAltitude(), fb.g.getAltitude(), u);
+    out.hAcc = lerp(fa.g.getHAcc(), fb.g.getHAcc(), u);
+    out.vAcc = lerp(fa.g.getVAcc(), fb.g.getVAcc(), u);
+    const bool motion = motion_valid(fa.g) && motion_valid(fb.g);
+    out.speed = motion ? lerp(fa.g.getSpeed(), fb.g.getSpeed(), u) : -1.0;
+    out.course = motion ? lerp_deg(fa.g.getCourse(), fb.g.getCourse(), u) : -1.0;
+    out.interpolated = true;
+}
@@ -0,0 +1,334 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "latency.hpp"
+#include "udpServer.hpp"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+namespace {
+    // datagrams per recvmmsg call, and the largest one accepted
+    constexpr int batch = 64;
+    constexpr std::size_t datagram_max = 16 * 1024;
+    // sources silent this long are forgotten (their handler is destroyed)
+    constexpr std::chrono::seconds source_idle(60);
+    // a frame this many windows behind the one due is from a restarted sender
+    constexpr int restart_windows = 4;
+}
+
+udpServer::udpServer(int port, ingestServer::factory make, int window,
+                     std::chrono::milliseconds max_delay)
+    : port_(port),
+      make_(std::move(make)),
+      max_delay_(max_delay)
+{
+    // a power of two, so seq % window_ stays consistent across seq wrap
+    window_ = 1;
+    while (window_ < window) window_ *= 2;
+}
+
+udpServer::~udpServer()
+{
+    sources_.clear();
+    if (fd_ >= 0) ::close(fd_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+#ifndef __linux__
+    if (wake_write_fd_ >= 0) ::close(wake_write_fd_);
+#endif
+}
+
+bool udpServer::start()
+{
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) { std::perror("socket"); return false; }
+
+    // room for bursts while the thread is busy with the previous batch
+    const int rcvbuf = 4 << 20;
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    sockaddr_in addr;
+    if (!listenAddress{host_, port_}.resolve(addr)) return false;
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("bind");
+        return false;
+    }
+
+#ifdef __linux__
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) { std::perror("eventfd"); return false; }
+#else
+    int p[2];
+    if (::pipe(p) != 0) { std::perror("pipe"); return false; }
+    wake_fd_ = p[0];
+    wake_write_fd_ = p[1];
+#endif
+    return true;
+}
+
+void udpServer::stop()
+{
+    if (wake_fd_ < 0) return;
+#ifdef __linux__
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+#else
+    const char one = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_write_fd_, &one, 1);
+#endif
+}
+
+udpServer::stats udpServer::totals() const
+{
+    stats s;
+    s.datagrams = count_.datagrams.load(std::memory_order_relaxed);
+    s.frames = count_.frames.load(std::memory_order_relaxed);
+    s.samples = count_.samples.load(std::memory_order_relaxed);
+    s.reordered = count_.reordered.load(std::memory_order_relaxed);
+    s.lost_frames = count_.lost_frames.load(std::memory_order_relaxed);
+    s.late_samples = count_.late_samples.load(std::memory_order_relaxed);
+    s.dropped_samples = count_.dropped_samples.load(std::memory_order_relaxed);
+    s.bad = count_.bad.load(std::memory_order_relaxed);
+    return s;
+}
+
+// -------- receive loop --------
+
+void udpServer::run()
+{
+    std::vector<char> buf(static_cast<std::size_t>(batch) * datagram_max);
+    sockaddr_storage from[batch];
+#ifdef __linux__
+    iovec iov[batch];
+    mmsghdr msgs[batch];
+#endif
+    std::vector<source*> touched;
+
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+    // wake up often enough to release frames held for a missing one
+    const int tick_ms = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(max_delay_).count() / 2 + 1);
+
+    while (true) {
+        const int r = ::poll(fds, 2, tick_ms);
+        if (r < 0 && errno != EINTR) {
+            std::perror("poll");
+            return;
+        }
+        if (r > 0 && (fds[1].revents & POLLIN)) return;
+
+        // Drain the socket, a batch per syscall
+        while (r > 0) {
+            const latency::tick t0 = latency::now();
+            int got = 0;
+            int lens[batch];
+            bool trunc[batch];
+#ifdef __linux__
+            for (int i = 0; i < batch; ++i) {
+                iov[i] = {buf.data() + i * datagram_max, datagram_max};
+                std::memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+                msgs[i].msg_hdr.msg_name = &from[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            got = ::recvmmsg(fd_, msgs, batch, MSG_DONTWAIT, nullptr);
+            for (int i = 0; i < got; ++i) {
+                lens[i] = static_cast<int>(msgs[i].msg_len);
+                trunc[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+            }
+            socklen_t from_len[batch];
+            for (int i = 0; i < got; ++i) from_len[i] = msgs[i].msg_hdr.msg_namelen;
+#else
+            socklen_t from_len[batch];
+            for (; got < batch; ++got) {
+                from_len[got] = sizeof(from[got]);
+                const ssize_t n = ::recvfrom(fd_, buf.data() + got * datagram_max, datagram_max,
+                                             MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from[got]),
+                                             &from_len[got]);
+                if (n < 0) break;
+                lens[got] = static_cast<int>(n);
+                trunc[got] = static_cast<std::size_t>(n) == datagram_max;
+            }
+            if (got == 0) got = -1;
+#endif
+            if (got <= 0) {
+                if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    std::perror("recvmmsg");
+                }
+                break;
+            }
+            latency::record(latency::stage::read, t0);
+            latency::mark_arrival();
+
+            const clock::time_point now = clock::now();
+            for (int i = 0; i < got; ++i) {
+                const std::string key(reinterpret_cast<const char*>(&from[i]), from_len[i]);
+                auto it = sources_.find(key);
+                if (it == sources_.end()) {
+                    it = sources_.emplace(key, source{}).first;
+                    it->second.h = make_(next_id_++);
+                    it->second.slots.resize(static_cast<std::size_t>(window_));
+                }
+                source& s = it->second;
+                s.last_seen = now;
+                count_.datagrams.fetch_add(1, std::memory_order_relaxed);
+                if (trunc[i]) {
+                    count_.bad.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                datagram_(s, buf.data() + i * datagram_max, static_cast<std::size_t>(lens[i]), now);
+                touched.push_back(&s);
+            }
+            if (got < batch) break;
+        }
+
+        for (source* s : touched) s->h->on_idle();
+        touched.clear();
+        expire_(clock::now());
+    }
+}
+
+// -------- per-source ordering --------
+
+void udpServer::datagram_(source& s, const char* p, std::size_t n, clock::time_point now)
+{
+    s.h->on_read(n);
+    const char* end = p + n;
+    while (p < end) {
+        if (static_cast<unsigned char>(*p) == wire::magic0) {
+            wire::header h;
+            if (static_cast<std::size_t>(end - p) < wire::header_size || !wire::read_header(p, h) ||
+                static_cast<std::size_t>(end - p) < wire::header_size + h.length) {
+                count_.bad.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const std::size_t size = wire::header_size + h.length;
+            frame_(s, p, size, h, now);
+            p += size;
+            continue;
+        }
+
+        // NDJSON: no sequence, straight through
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        std::string_view line(p, static_cast<std::size_t>((nl ? nl : end) - p));
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (!line.empty()) s.h->on_line(line);
+        p = nl ? nl + 1 : end;
+    }
+}
+
+void udpServer::frame_(source& s, const char* p, std::size_t n, const wire::header& h,
+                       clock::time_point now)
+{
+    if (!s.started) {
+        s.started = true;
+        s.next = h.seq;
+    }
+
+    // distance from the frame due next, modulo 2^32
+    std::int32_t d = static_cast<std::int32_t>(h.seq - s.next);
+    if (d < -restart_windows * window_) {
+        // far behind anything that could still be in flight: the sender
+        // restarted its sequence, so the old stream ends here
+        flush_(s);
+        s.next = h.seq;
+        d = 0;
+    } else if (d < 0) {
+        count_.late_samples.fetch_add(h.count, std::memory_order_relaxed);
+        return;
+    }
+    // too far ahead: give up on the oldest frames until it fits the window,
+    // in one step for a jump of any size
+    if (d >= window_) {
+        const std::uint32_t next = h.seq - static_cast<std::uint32_t>(window_ - 1);
+        if (d >= 2 * window_) {
+            // every held frame is now due
+            flush_(s);
+        } else {
+            while (s.next != next) skip_(s);
+        }
+        count_.lost_frames.fetch_add(next - s.next, std::memory_order_relaxed);
+        s.next = next;
+        d = window_ - 1;
+    }
+
+    slot& sl = s.slots[h.seq & static_cast<std::uint32_t>(window_ - 1)];
+    if (sl.full) {
+        count_.dropped_samples.fetch_add(h.count, std::memory_order_relaxed);
+        return;
+    }
+    sl.full = true;
+    sl.bytes.assign(p, n);
+    if (s.pending++ == 0) s.waiting_since = now;
+    if (d > 0) {
+        // it overtook at least one frame
+        count_.reordered.fetch_add(1, std::memory_order_relaxed);
+    }
+    drain_(s);
+}
+
+void udpServer::deliver_(source& s, const std::string& bytes)
+{
+    wire::header h;
+    wire::read_header(bytes.data(), h);
+    s.h->on_frame(h, std::string_view(bytes).substr(wire::header_size, h.length));
+    count_.frames.fetch_add(1, std::memory_order_relaxed);
+    count_.samples.fetch_add(h.count, std::memory_order_relaxed);
+}
+
+void udpServer::drain_(source& s)
+{
+    bool moved = false;
+    while (true) {
+        slot& sl = s.slots[s.next & static_cast<std::uint32_t>(window_ - 1)];
+        if (!sl.full) break;
+        deliver_(s, sl.bytes);
+        sl.full = false;
+        --s.pending;
+        ++s.next;
+        moved = true;
+    }
+    // the wait for the next gap starts now
+    if (moved && s.pending > 0) s.waiting_since = clock::now();
+}
+
+void udpServer::skip_(source& s)
+{
+    slot& sl = s.slots[s.next & static_cast<std::uint32_t>(window_ - 1)];
+    if (sl.full) {
+        deliver_(s, sl.bytes);
+        sl.full = false;
+        --s.pending;
+    } else {
+        count_.lost_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    ++s.next;
+}
+
+void udpServer::flush_(source& s)
+{
+    // held frames are at most window_ - 1 past the next one due
+    while (s.pending > 0) skip_(s);
+}
+
+void udpServer::expire_(clock::time_point now)
+{
+    for (auto it = sources_.begin(); it != sources_.end();) {
+        source& s = it->second;
+        if (s.pending > 0 && now - s.waiting_since >= max_delay_) {
+            // stop waiting for the missing frame(s) in front
+            while (!s.slots[s.next & static_cast<std::uint32_t>(window_ - 1)].full) skip_(s);
+            drain_(s);
+            s.h->on_idle();
+        }
+        if (now - s.last_seen >= source_idle) it = sources_.erase(it);
+        else ++it;
+    }
+}
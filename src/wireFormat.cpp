@@ -0,0 +1,288 @@
+#include <cmath>
+#include <cstring>
+#include "lineFramer.hpp"
+#include "wireFormat.hpp"
+
+namespace {
+    // Little-endian stores and loads, whatever the host order; compilers
+    // turn these into plain moves on x86 and ARM.
+    void put_u16(char*& p, std::uint16_t v) {
+        p[0] = static_cast<char>(v);
+        p[1] = static_cast<char>(v >> 8);
+        p += 2;
+    }
+    void put_u32(char*& p, std::uint32_t v) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i));
+        p += 4;
+    }
+    void put_u64(char*& p, std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) p[i] = static_cast<char>(v >> (8 * i));
+        p += 8;
+    }
+    void put_f32(char*& p, float v) {
+        std::uint32_t u;
+        std::memcpy(&u, &v, 4);
+        put_u32(p, u);
+    }
+    void put_f64(char*& p, double v) {
+        std::uint64_t u;
+        std::memcpy(&u, &v, 8);
+        put_u64(p, u);
+    }
+    void put_i16(char*& p, double v, double scale) {
+        const double q = std::round(v * scale);
+        put_u16(p, static_cast<std::uint16_t>(static_cast<std::int16_t>(
+                       q > 32767.0 ? 32767.0 : (q < -32767.0 ? -32767.0 : q))));
+    }
+
+    std::uint16_t get_u16(const char*& p) {
+        const auto* u = reinterpret_cast<const unsigned char*>(p);
+        p += 2;
+        return static_cast<std::uint16_t>(u[0] | (u[1] << 8));
+    }
+    std::uint32_t get_u32(const char*& p) {
+        const auto* u = reinterpret_cast<const unsigned char*>(p);
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(u[i]) << (8 * i);
+        p += 4;
+        return v;
+    }
+    std::uint64_t get_u64(const char*& p) {
+        const auto* u = reinterpret_cast<const unsigned char*>(p);
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(u[i]) << (8 * i);
+        p += 8;
+        return v;
+    }
+    float get_f32(const char*& p) {
+        const std::uint32_t u = get_u32(p);
+        float v;
+        std::memcpy(&v, &u, 4);
+        return v;
+    }
+    double get_f64(const char*& p) {
+        const std::uint64_t u = get_u64(p);
+        double v;
+        std::memcpy(&v, &u, 8);
+        return v;
+    }
+    double get_i16(const char*& p, double scale) {
+        return static_cast<std::int16_t>(get_u16(p)) / scale;
+    }
+
+    constexpr double quat_scale = 32767.0;
+    constexpr double acc_scale = 4096.0;
+
+    // time offsets are whole microseconds from base_t
+    void put_dt(char*& p, double t, double base_t) {
+        const double us = std::round((t - base_t) * 1e6);
+        put_u32(p, us <= 0 ? 0u : (us >= 4294967295.0 ? 4294967295u : static_cast<std::uint32_t>(us)));
+    }
+    double get_dt(const char*& p, double base_t) {
+        return base_t + get_u32(p) * 1e-6;
+    }
+
+    char* put_header(std::string& out, wire::kind k, wire::encoding enc, std::size_t n,
+                     std::uint32_t seq, double base_t) {
+        const std::size_t len = n * wire::record_size(k, enc);
+        const std::size_t at = out.size();
+        out.resize(at + wire::header_size + len);
+        char* p = &out[at];
+        *p++ = static_cast<char>(wire::magic0);
+        *p++ = static_cast<char>(wire::magic1);
+        *p++ = static_cast<char>(wire::version);
+        *p++ = static_cast<char>(k);
+        *p++ = static_cast<char>(enc);
+        *p++ = 0;
+        put_u16(p, static_cast<std::uint16_t>(n));
+        put_u32(p, seq);
+        put_u32(p, static_cast<std::uint32_t>(len));
+        put_f64(p, base_t);
+        return p;
+    }
+}
+
+namespace wire {
+
+std::size_t record_size(kind k, encoding enc)
+{
+    if (k == kind::imu) {
+        switch (enc) {
+        case encoding::f64: return 8 + 7 * 8;
+        case encoding::f32: return 4 + 7 * 4;
+        case encoding::q16: return 4 + 7 * 2;
+        }
+    } else if (k == kind::gps) {
+        switch (enc) {
+        case encoding::f64: return 9 * 8;
+        case encoding::f32: return 4 + 2 * 8 + 5 * 4 + 8;
+        case encoding::q16: return 0;
+        }
+    }
+    return 0;
+}
+
+bool encode(const IMUsample* s, std::size_t n, encoding enc, std::uint32_t seq, std::string& out)
+{
+    if (record_size(kind::imu, enc) == 0 || n > max_records(kind::imu, enc)) return false;
+    const double base_t = n > 0 ? s[0].getTimestamp() : 0.0;
+    char* p = put_header(out, kind::imu, enc, n, seq, base_t);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const double* q = s[i].getQuat();
+        const double* a = s[i].getAccG();
+        switch (enc) {
+        case encoding::f64:
+            put_f64(p, s[i].getTimestamp());
+            for (int j = 0; j < 4; ++j) put_f64(p, q[j]);
+            for (int j = 0; j < 3; ++j) put_f64(p, a[j]);
+            break;
+        case encoding::f32:
+            put_dt(p, s[i].getTimestamp(), base_t);
+            for (int j = 0; j < 4; ++j) put_f32(p, static_cast<float>(q[j]));
+            for (int j = 0; j < 3; ++j) put_f32(p, static_cast<float>(a[j]));
+            break;
+        case encoding::q16:
+            put_dt(p, s[i].getTimestamp(), base_t);
+            for (int j = 0; j < 4; ++j) put_i16(p, q[j], quat_scale);
+            for (int j = 0; j < 3; ++j) put_i16(p, a[j], acc_scale);
+            break;
+        }
+    }
+    return true;
+}
+
+bool encode(const GPSsample* s, std::size_t n, encoding enc, std::uint32_t seq, std::string& out)
+{
+    if (record_size(kind::gps, enc) == 0 || n > max_records(kind::gps, enc)) return false;
+    const double base_t = n > 0 ? s[0].getTime() : 0.0;
+    char* p = put_header(out, kind::gps, enc, n, seq, base_t);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const GPSsample& g = s[i];
+        if (enc == encoding::f64) {
+            put_f64(p, g.getTime());
+            put_f64(p, g.getLatitude());
+            put_f64(p, g.getLongitude());
+            put_f64(p, g.getAltitude());
+            put_f64(p, g.getHAcc());
+            put_f64(p, g.getVAcc());
+            put_f64(p, g.getSpeed());
+            put_f64(p, g.getCourse());
+        } else {
+            put_dt(p, g.getTime(), base_t);
+            put_f64(p, g.getLatitude());
+            put_f64(p, g.getLongitude());
+            put_f32(p, static_cast<float>(g.getAltitude()));
+            put_f32(p, static_cast<float>(g.getHAcc()));
+            put_f32(p, static_cast<float>(g.getVAcc()));
+            put_f32(p, static_cast<float>(g.getSpeed()));
+            put_f32(p, static_cast<float>(g.getCourse()));
+        }
+        put_f64(p, g.getTGPS());
+    }
+    return true;
+}
+
+bool read_header(const char* p, header& h)
+{
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    if (u[0] != magic0 || u[1] != magic1 || u[2] != version || u[5] != 0) return false;
+    h.k = static_cast<kind>(u[3]);
+    h.enc = static_cast<encoding>(u[4]);
+    p += 6;
+    h.count = get_u16(p);
+    h.seq = get_u32(p);
+    h.length = get_u32(p);
+    h.base_t = get_f64(p);
+
+    const std::size_t r = record_size(h.k, h.enc);
+    return r != 0 && h.length == h.count * r && header_size + h.length <= max_frame;
+}
+
+bool decode(const header& h, std::string_view payload, std::vector<IMUsample>& out)
+{
+    if (h.k != kind::imu || payload.size() != h.length) return false;
+    out.resize(h.count);
+    const char* p = payload.data();
+    double q[4], a[3];
+    for (auto& s : out) {
+        switch (h.enc) {
+        case encoding::f64:
+            s.setTimestamp(get_f64(p));
+            for (double& v : q) v = get_f64(p);
+            for (double& v : a) v = get_f64(p);
+            break;
+        case encoding::f32:
+            s.setTimestamp(get_dt(p, h.base_t));
+            for (double& v : q) v = get_f32(p);
+            for (double& v : a) v = get_f32(p);
+            break;
+        case encoding::q16:
+            s.setTimestamp(get_dt(p, h.base_t));
+            for (double& v : q) v = get_i16(p, quat_scale);
+            for (double& v : a) v = get_i16(p, acc_scale);
+            break;
+        }
+        s.setQuat(q);
+        s.setAccG(a);
+    }
+    return true;
+}
+
+bool decode(const header& h, std::string_view payload, std::vector<GPSsample>& out)
+{
+    if (h.k != kind::gps || payload.size() != h.length) return false;
+    out.resize(h.count);
+    const char* p = payload.data();
+    for (auto& g : out) {
+        if (h.enc == encoding::f64) {
+            g.setTime(get_f64(p));
+            g.setLatitude(get_f64(p));
+            g.setLongitude(get_f64(p));
+            g.setAltitude(get_f64(p));
+            g.setHAcc(get_f64(p));
+            g.setVAcc(get_f64(p));
+            g.setSpeed(get_f64(p));
+            g.setCourse(get_f64(p));
+        } else {
+            g.setTime(get_dt(p, h.base_t));
+            g.setLatitude(get_f64(p));
+            g.setLongitude(get_f64(p));
+            g.setAltitude(get_f32(p));
+            g.setHAcc(get_f32(p));
+            g.setVAcc(get_f32(p));
+            g.setSpeed(get_f32(p));
+            g.setCourse(get_f32(p));
+        }
+        g.setTGPS(get_f64(p));
+    }
+    return true;
+}
+
+bool next(lineFramer& f, message& m, std::size_t* bad_frames)
+{
+    while (true) {
+        const std::string_view p = f.peek();
+        if (!p.empty() && static_cast<unsigned char>(p[0]) == magic0) {
+            if (p.size() < header_size) return false;  // wait for the rest
+            header h;
+            if (!read_header(p.data(), h)) {
+                if (bad_frames) ++*bad_frames;
+                f.consume(1);
+                continue;
+            }
+            if (p.size() < header_size + h.length) return false;
+            m.binary = true;
+            m.hdr = h;
+            m.payload = p.substr(header_size, h.length);
+            f.consume(header_size + h.length);
+            return true;
+        }
+        if (!f.next(m.line)) return false;
+        m.binary = false;
+        return true;
+    }
+}
+
+} // namespace wire
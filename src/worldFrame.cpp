@@ -0,0 +1,130 @@
+#include <cmath>
+#include "worldFrame.hpp"
+
+namespace {
+    // One group of lanes as a single SIMD value (GCC/Clang vector
+    // extension), as in batchDenoiser.cpp
+    typedef double vec_t
+        __attribute__((vector_size(sizeof(double) * worldFrame::lanes), aligned(sizeof(double)), may_alias));
+
+    inline const vec_t& row(const double* p) { return *reinterpret_cast<const vec_t*>(p); }
+    inline vec_t& row(double* p) { return *reinterpret_cast<vec_t*>(p); }
+
+    // a := R(q) a - g for a vector of lanes or one double. R(q) is the
+    // rotation matrix of q / |q|, written with s = 2 / |q|^2.
+    template <typename T>
+    void rotate(const T& w, const T& x, const T& y, const T& z, T& ax, T& ay, T& az, const double* g)
+    {
+        const T n = w * w + x * x + y * y + z * z;
+        const T inv = 2.0 / n;
+        const T s = n > 0.0 ? inv : T{};
+
+        const T xx = s * x * x, yy = s * y * y, zz = s * z * z;
+        const T xy = s * x * y, xz = s * x * z, yz = s * y * z;
+        const T wx = s * w * x, wy = s * w * y, wz = s * w * z;
+
+        const T rx = (1.0 - yy - zz) * ax + (xy - wz) * ay + (xz + wy) * az;
+        const T ry = (xy + wz) * ax + (1.0 - xx - zz) * ay + (yz - wx) * az;
+        const T rz = (xz - wy) * ax + (yz + wx) * ay + (1.0 - xx - yy) * az;
+        ax = rx - g[0];
+        ay = ry - g[1];
+        az = rz - g[2];
+    }
+}
+
+worldFrame::worldFrame(const options& o) : opt_(o), qw_{}, qx_{}, qy_{}, qz_{}, ax_{}, ay_{}, az_{}, t_{}
+{
+}
+
+void worldFrame::orient(double t, const quat& q)
+{
+    if (tracked_ > 0 && !(t > track_[tracked_ - 1].t)) {
+        track_[tracked_ - 1].q = q;
+        return;
+    }
+    if (tracked_ == static_cast<int>(track_.size())) {
+        for (int i = 1; i < tracked_; ++i) track_[i - 1] = track_[i];
+        --tracked_;
+    }
+    track_[tracked_++] = {t, q};
+}
+
+worldFrame::quat worldFrame::at_(double t) const
+{
+    if (tracked_ == 0) return {1.0, 0.0, 0.0, 0.0};
+    if (t <= track_[0].t) return track_[0].q;
+    for (int i = 1; i < tracked_; ++i) {
+        const stamped& b = track_[i];
+        if (t > b.t) continue;
+        if (t == b.t) return b.q;
+        const stamped& a = track_[i - 1];
+        return slerp(a.q, b.q, (t - a.t) / (b.t - a.t));
+    }
+    return track_[tracked_ - 1].q;  // newer than any orientation: hold the last
+}
+
+bool worldFrame::add(double t, double x, double y, double z)
+{
+    if (n_ == batch) return false;
+    const quat q = at_(t);
+    qw_[n_] = q.w;
+    qx_[n_] = q.x;
+    qy_[n_] = q.y;
+    qz_[n_] = q.z;
+    ax_[n_] = x;
+    ay_[n_] = y;
+    az_[n_] = z;
+    t_[n_] = t;
+    ++n_;
+    return true;
+}
+
+int worldFrame::run()
+{
+    // whole rows: lanes past n_ hold stale (but finite) values and are ignored
+    const int rows = (n_ + lanes - 1) / lanes * lanes;
+    transform(qw_, qx_, qy_, qz_, ax_, ay_, az_, rows, opt_.gravity);
+    return n_;
+}
+
+void worldFrame::transform(const double* qw, const double* qx, const double* qy, const double* qz,
+                           double* ax, double* ay, double* az, int n, const double* gravity)
+{
+    int i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        rotate(row(qw + i), row(qx + i), row(qy + i), row(qz + i), row(ax + i), row(ay + i), row(az + i),
+               gravity);
+    }
+    for (; i < n; ++i) rotate(qw[i], qx[i], qy[i], qz[i], ax[i], ay[i], az[i], gravity);
+}
+
+worldFrame::quat worldFrame::slerp(const quat& a, const quat& b, double u)
+{
+    const double na = std::sqrt(a.w * a.w + a.x * a.x + a.y * a.y + a.z * a.z);
+    const double nb = std::sqrt(b.w * b.w + b.x * b.x + b.y * b.y + b.z * b.z);
+    if (!(na > 0.0) || !(nb > 0.0)) return u < 0.5 ? a : b;
+
+    const quat p{a.w / na, a.x / na, a.y / na, a.z / na};
+    quat q{b.w / nb, b.x / nb, b.y / nb, b.z / nb};
+    double d = p.w * q.w + p.x * q.x + p.y * q.y + p.z * q.z;
+    if (d < 0.0) {
+        // q and -q are the same rotation: take the short way round
+        q = {-q.w, -q.x, -q.y, -q.z};
+        d = -d;
+    }
+
+    double wa, wb;
+    if (d > 0.9995) {
+        // nearly parallel: sin(theta) is too small to divide by, lerp instead
+        wa = 1.0 - u;
+        wb = u;
+    } else {
+        const double theta = std::acos(d);
+        const double s = std::sin(theta);
+        wa = std::sin((1.0 - u) * theta) / s;
+        wb = std::sin(u * theta) / s;
+    }
+    quat r{wa * p.w + wb * q.w, wa * p.x + wb * q.x, wa * p.y + wb * q.y, wa * p.z + wb * q.z};
+    const double nr = std::sqrt(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z);
+    return {r.w / nr, r.x / nr, r.y / nr, r.z / nr};
+}